@@ -11,6 +11,7 @@
 
 #include "Compressor.h"
 #include <math.h>
+#include <stdio.h>
 
 //-------------------------------------------------------------------------------------------------------
 AudioEffect* createEffectInstance (audioMasterCallback audioMaster)
@@ -22,7 +23,7 @@ AudioEffect* createEffectInstance (audioMasterCallback audioMaster)
 Compressor::Compressor (audioMasterCallback audioMaster)
 : AudioEffectX (audioMaster, 1, kNumParams)	// 1 program, 1 parameter only
 {
-	setNumInputs (kNumInputs);       // stereo in
+	setNumInputs (kNumInputs);       // stereo in, stereo key
 	setNumOutputs (kNumOutputs);     // stereo out
 	setUniqueID ('Cmpr');            // identify
 	canProcessReplacing ();          // supports replacing output
@@ -48,6 +49,7 @@ Compressor::Compressor (audioMasterCallback audioMaster)
 	output_gain = dB2lin(SmartKnob::knob2value(OutputGainKnob, OGainLimits, OGainTaper));
 	threshold = dB2lin(SmartKnob::knob2value(ThresholdKnob, ThresholdLimits, ThresholdTaper));
 	logthresh = dB(threshold);
+	log2thresh = log2(threshold);
     attack_time = SmartKnob::knob2value(AttackKnob, ARateLimits, ARateTaper);
 	release_time = SmartKnob::knob2value(ReleaseKnob, RRateLimits, RRateTaper);
     peak_detector.setTauAttack( attack_time, the_sample_rate);
@@ -55,18 +57,294 @@ Compressor::Compressor (audioMasterCallback audioMaster)
     
     ////////////////////////////////////////////////////////////////////////////
     // TODO - Problem 2: handle the compression ratio knob
+    comp_ratio = SmartKnob::knob2value(RatioKnob, RatioLimits, RatioTaper);
+    comp_slope = (RatioKnob >= 1.0) ? 1.0 : 1.0 - 1.0/comp_ratio;     // top of the range limits
     ////////////////////////////////////////////////////////////////////////////
 
     ////////////////////////////////////////////////////////////////////////////
     // TODO - Problem 3: handle the detector exponent (p) knob
     ExponentKnob = 0.0;
-    exponent = SmartKnob::knob2value(ExponentKnob, ERateLimits, ERateTaper);
-    peak_detector.setExponent( exponent, the_sample_rate );
+    setExponent(SmartKnob::knob2value(ExponentKnob, ERateLimits, ERateTaper));
     ////////////////////////////////////////////////////////////////////////////
     
 	gainval = 1.0;
 	dbgainval = 0.0;
     
+    // multiband mode, off to begin with
+    BandsKnob = 0.0;
+    num_bands = 1;
+    xover_low = 200.0;
+    XoverLowKnob = SmartKnob::value2knob(xover_low, XoverLowLimits, XoverLowTaper);
+    xover_high = 5000.0;
+    XoverHighKnob = SmartKnob::value2knob(xover_high, XoverHighLimits, XoverHighTaper);
+    for (int b = 0; b < kMaxBands; b++) {
+        BandThreshKnob[b] = 0.5;
+        band_trim[b] = SmartKnob::knob2value(BandThreshKnob[b], BandThreshLimits, BandThreshTaper);
+    }
+    designBands();
+    
+    // lookahead limiter, off to begin with
+    LimiterKnob = 0.0;
+    limiter_on = false;
+    LookaheadKnob = 0.0;
+    lookahead_time = 0.0;
+    limiter.reserve(maxLookaheadWindow());
+    limiter.setRelease(release_time, the_sample_rate);
+    lookahead_dirty = false;
+    ceiling = dB2lin(-1.0);                     // just under full scale, -1 dBTP
+    CeilingKnob = SmartKnob::value2knob(-1.0, CeilingLimits, CeilingTaper);
+    
+    // key: the main input, unfiltered
+    KeySourceKnob = 0.0;
+    key_external = false;
+    KeyFilterKnob = 0.0;
+    key_filter_type = kKeyFilterOff;
+    key_freq = 100.0;
+    KeyFreqKnob = SmartKnob::value2knob(key_freq, KeyFreqLimits, KeyFreqTaper);
+    key_q = 0.7071;
+    KeyQKnob = SmartKnob::value2knob(key_q, KeyQLimits, KeyQTaper);
+    designKeyFilter();
+    
+    // linked detector
+    LinkKnob = 0.0;
+    link_mode = kLinkStereo;
+    
+    // fixed release
+    AutoReleaseKnob = 0.0;
+    auto_release = false;
+    
+    // detect on the samples
+    TruePeakKnob = 0.0;
+    true_peak = false;
+    resume();
+}
+
+//-------------------------------------------------------------------------------------------------------
+void Compressor::setSampleRate (float sampleRate)
+{
+	AudioEffectX::setSampleRate(sampleRate);
+	the_sample_rate = sampleRate;
+	peak_detector.setTauAttack( attack_time, the_sample_rate );
+	peak_detector.setTauRelease( release_time, the_sample_rate );
+	bands_dirty = true;
+	limiter.reserve(maxLookaheadWindow());
+	limiter.setRelease(release_time, the_sample_rate);
+	limiter.setWindow(lookaheadWindow());
+	setInitialDelay(latency());
+	designKeyFilter();
+}
+
+//-------------------------------------------------------------------------------------------------------
+void Compressor::resume ()
+{
+	peak_detector.reset();
+	stereo_detector.reset();
+	crossover.reset();
+	key_crossover.reset();
+	band_detectors.reset();
+	key_filter[0].reset();
+	key_filter[1].reset();
+	for (int b = 0; b < kMaxBands; b++) {
+		band_gain[b] = 1.0;
+		band_step[b] = 0.0;
+	}
+	gain_count = 0;
+	resetTruePeak();
+	
+	// the switches that add latency take effect here, where the host reads it
+	true_peak = (TruePeakKnob >= 0.5);
+	limiter_on = (LimiterKnob >= 0.5);
+	limiter.reset();
+	limiter.setWindow(lookaheadWindow());
+	lookahead_dirty = false;
+	setInitialDelay(latency());
+}
+
+//-------------------------------------------------------------------------------------------------------
+void Compressor::resetTruePeak ()
+{
+	true_peak_detector.reset();
+	memset(true_peak_delay, 0, sizeof(true_peak_delay));
+	for (int b = 0; b < kMaxBands; b++)
+		band_true_peak[b].reset();
+	memset(band_delay, 0, sizeof(band_delay));
+	true_peak_pos = 0;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// Crossovers spread geometrically from xover_low to xover_high (kept below Nyquist), and the band
+// thresholds. A new band count clears the band filters, since every lane changes its job.
+void Compressor::designBands ()
+{
+	bands_dirty = false;
+	int bands = 1 + (int)(BandsKnob*(kMaxBands-1) + 0.5);
+	if (bands != num_bands) {
+		crossover.reset();
+		key_crossover.reset();
+		resetTruePeak();            // or the delays replay audio from the last time this mode ran
+	}
+	num_bands = bands;
+	for (int b = 0; b < kMaxBands; b++) {
+		band_thresh[b] = threshold*dB2lin(band_trim[b]);
+		band_log2thresh[b] = log2(band_thresh[b]);
+	}
+	if (num_bands < 2)
+		return;
+    
+	double freqs[kMaxBands];
+	double high = min(xover_high, 0.45*the_sample_rate);
+	double low = min(xover_low, high);
+	for (int k = 0; k < num_bands-1; k++)
+		freqs[k] = (num_bands == 2) ? sqrt(low*high) : low*pow(high/low, (double)k/(num_bands-2));
+	crossover.design(num_bands, freqs, the_sample_rate);
+	key_crossover.design(num_bands, freqs, the_sample_rate);
+}
+
+//-------------------------------------------------------------------------------------------------------
+// Pins 1 and 2 are the main input, 3 and 4 the key, each pair a stereo bus
+bool Compressor::getInputProperties (VstInt32 index, VstPinProperties* properties)
+{
+	if (index < 0 || index >= kNumInputs)
+		return false;
+	bool key = (index >= 2);
+	snprintf(properties->label, kVstMaxLabelLen, "%s %s", key ? "Key" : "Main", (index % 2) ? "R" : "L");
+	vst_strncpy(properties->shortLabel, key ? (index % 2 ? "KeyR" : "KeyL") : (index % 2 ? "InR" : "InL"),
+				kVstMaxShortLabelLen - 1);
+	properties->flags = kVstPinIsActive | ((index % 2) ? 0 : kVstPinIsStereo);
+	properties->arrangementType = kSpeakerArrStereo;
+	return true;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// Analog prototype to digital biquad, [b0 b1 b2 a0 a1 a2] in s to [b0 b1 b2 a1 a2] in z
+void Compressor::bilinearTransform(double acoefs[], double dcoefs[])
+{
+	double b0, b1, b2, a0, a1, a2;		    //storage for continuous-time filter coefs
+	double bz0, bz1, bz2, az0, az1, az2;	// coefs for discrete-time filter.
+	
+	// For easier looking code...unpack
+	b0 = acoefs[0]; b1 = acoefs[1]; b2 = acoefs[2]; 
+	a0 = acoefs[3]; a1 = acoefs[4]; a2 = acoefs[5];
+	
+	double T = 1/the_sample_rate;
+	double Tsq = T*T;
+	
+	// normalized, since the biquad struct assumes az0 = 1
+	az0 = ( a0*Tsq + 2*a1*T + 4*a2 );
+	az1 = ( 2*a0*Tsq - 8*a2 ) / az0; 
+	az2 = ( a0*Tsq - 2*a1*T + 4*a2 ) / az0;
+	
+	bz0 = ( b0*Tsq + 2*b1*T + 4*b2 ) / az0; 
+	bz1 = ( 2*b0*Tsq - 8*b2 ) / az0;
+	bz2 = ( b0*Tsq - 2*b1*T + 4*b2 ) / az0; 
+	
+	// return coefficients to the output
+	dcoefs[0] = bz0; dcoefs[1] = bz1; dcoefs[2] = bz2; 
+	dcoefs[3] = az1; dcoefs[4] = az2;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// Key filter: second-order highpass, or a bandpass with 0 dB at its centre, at key_freq with
+// resonance key_q. The frequency is prewarped so it lands where the knob says.
+void Compressor::designKeyFilter()
+{
+	double acoefs[6], dcoefs[5];
+	double fc = min(key_freq, 0.45*the_sample_rate);
+	double wc = 2*the_sample_rate*tan(M_PI*fc/the_sample_rate);
+	
+	acoefs[0] = 0.0;
+	acoefs[1] = (key_filter_type == kKeyFilterBP) ? 1.0/(wc*key_q) : 0.0;
+	acoefs[2] = (key_filter_type == kKeyFilterBP) ? 0.0 : 1.0/(wc*wc);
+	acoefs[3] = 1.0;
+	acoefs[4] = 1.0/(wc*key_q);
+	acoefs[5] = 1.0/(wc*wc);
+	bilinearTransform(acoefs, dcoefs);
+	key_filter[0].setCoefs(dcoefs);
+	key_filter[1].setCoefs(dcoefs);
+}
+
+//-------------------------------------------------------------------------------------------------------
+// What the detector hears for frame i: the main input (after the input gain) or the key bus as it
+// comes in, then the key filter if there is one
+void Compressor::keySignal (float inp0, float inp1, float** inputs, int i, double& key0, double& key1)
+{
+	if (key_external) {
+		key0 = inputs[2][i];
+		key1 = inputs[3][i];
+	} else {
+		key0 = inp0;
+		key1 = inp1;
+	}
+	if (key_filter_type != kKeyFilterOff) {
+		key_filter[0].process(key0, key0);
+		key_filter[1].process(key1, key1);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------------
+// At least a frame, so the ceiling still holds with the knob at 0
+long Compressor::lookaheadWindow ()
+{
+	return max(1L, (long)(lookahead_time*the_sample_rate + 0.5));
+}
+
+//-------------------------------------------------------------------------------------------------------
+long Compressor::maxLookaheadWindow ()
+{
+	return (long)ceil(kMaxLookahead*the_sample_rate);
+}
+
+//-------------------------------------------------------------------------------------------------------
+// The true-peak delay and the limiter's, which is that of the longest lookahead whatever the knob
+// says, each only when it is switched in. Nothing with both off.
+long Compressor::latency ()
+{
+	return (true_peak ? kTruePeakDelay : 0) + (limiter_on ? limiter.latency() : 0);
+}
+
+//-------------------------------------------------------------------------------------------------------
+// The main signal kTruePeakDelay frames late, in step with the true-peak readings of its key
+void Compressor::alignWithTruePeak (float& inp0, float& inp1)
+{
+	float* d = true_peak_delay[true_peak_pos];
+	float late0 = d[0], late1 = d[1];
+	d[0] = inp0;
+	d[1] = inp1;
+	true_peak_pos = (true_peak_pos + 1 == kTruePeakDelay) ? 0 : true_peak_pos + 1;
+	inp0 = late0;
+	inp1 = late1;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// The same for every band of both channels, y[2*band + channel] from LRCrossoverBank::process()
+void Compressor::alignBandsWithTruePeak (double* bands)
+{
+	double* d = band_delay[true_peak_pos];
+	for (int k = 0; k < 2*num_bands; k++) {
+		double late = d[k];
+		d[k] = bands[k];
+		bands[k] = late;
+	}
+	true_peak_pos = (true_peak_pos + 1 == kTruePeakDelay) ? 0 : true_peak_pos + 1;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// Gain for a detected level: the part above the threshold, scaled by the ratio. Works on log2 of the
+// amplitudes (one unit is kDBPerLog2 dB), so with fastLog2()/fastExp2() around it there is no libm
+// call per sample.
+float Compressor::gainComputer (float log2level, float log2thresh)
+{
+	return min(0.0f, log2thresh - log2level)*comp_slope;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// p = 1 and p = 2 are by far the common settings (peak and RMS-like), and need no power functions
+void Compressor::setExponent (float ex)
+{
+	exponent = ex;
+	inv_exponent = 1.0f/ex;
+	detector_power = (ex == 1.0f) ? 1 : (fabsf(ex - 2.0f) < 1e-4f) ? 2 : 0;
+	peak_detector.setExponent(exponent, the_sample_rate);
 }
 
 //-------------------------------------------------------------------------------------------------------
@@ -100,6 +378,8 @@ void Compressor::setParameter (VstInt32 index, float value)
             ThresholdKnob=value;
             threshold = dB2lin(SmartKnob::knob2value(ThresholdKnob, ThresholdLimits, ThresholdTaper));
             logthresh=dB(threshold);
+            log2thresh=log2(threshold);
+            bands_dirty = true;
             break;
         case kParamAttack :
             AttackKnob = value;
@@ -110,6 +390,7 @@ void Compressor::setParameter (VstInt32 index, float value)
             ReleaseKnob = value;
             release_time = SmartKnob::knob2value(ReleaseKnob, RRateLimits, RRateTaper);
             peak_detector.setTauRelease( release_time, the_sample_rate );
+            limiter.setRelease( release_time, the_sample_rate );
             break;
         case kParamOutputGain:
             OutputGainKnob=value;
@@ -118,18 +399,81 @@ void Compressor::setParameter (VstInt32 index, float value)
         case kParamRatio:
             ////////////////////////////////////////////////////////////////////////////
             // TODO - Problem 2: implement
-            
+            RatioKnob = value;
+            comp_ratio = SmartKnob::knob2value(RatioKnob, RatioLimits, RatioTaper);
+            comp_slope = (RatioKnob >= 1.0) ? 1.0 : 1.0 - 1.0/comp_ratio;
             ////////////////////////////////////////////////////////////////////////////
             break;
         case kParamDetectorExponent:
             ////////////////////////////////////////////////////////////////////////////
             // TODO - Problem 3: implement
             ExponentKnob = value;
-            exponent = SmartKnob::knob2value(ExponentKnob, ERateLimits, ERateTaper);
-            peak_detector.setExponent(exponent, the_sample_rate);
+            setExponent(SmartKnob::knob2value(ExponentKnob, ERateLimits, ERateTaper));
             ////////////////////////////////////////////////////////////////////////////
             break;
+        case kParamBands:
+            BandsKnob = value;
+            bands_dirty = true;         // picked up by the next block
+            break;
+        case kParamXoverLow:
+            XoverLowKnob = value;
+            xover_low = SmartKnob::knob2value(XoverLowKnob, XoverLowLimits, XoverLowTaper);
+            bands_dirty = true;
+            break;
+        case kParamXoverHigh:
+            XoverHighKnob = value;
+            xover_high = SmartKnob::knob2value(XoverHighKnob, XoverHighLimits, XoverHighTaper);
+            bands_dirty = true;
+            break;
+        case kParamLookahead:
+            // the limiter takes the window at the next block; the latency stays as it is
+            LookaheadKnob = value;
+            lookahead_time = SmartKnob::knob2value(LookaheadKnob, LookaheadLimits, LookaheadTaper);
+            lookahead_dirty = true;
+            break;
+        case kParamKeySource:
+            KeySourceKnob = value;
+            key_external = (KeySourceKnob >= 0.5);
+            break;
+        case kParamKeyFilter:
+            KeyFilterKnob = value;
+            key_filter_type = min((int)(KeyFilterKnob*kNumKeyFilters), kNumKeyFilters - 1);
+            designKeyFilter();
+            break;
+        case kParamKeyFreq:
+            KeyFreqKnob = value;
+            key_freq = SmartKnob::knob2value(KeyFreqKnob, KeyFreqLimits, KeyFreqTaper);
+            designKeyFilter();
+            break;
+        case kParamKeyQ:
+            KeyQKnob = value;
+            key_q = SmartKnob::knob2value(KeyQKnob, KeyQLimits, KeyQTaper);
+            designKeyFilter();
+            break;
+        case kParamLink:
+            LinkKnob = value;
+            link_mode = min((int)(LinkKnob*kNumLinkModes), kNumLinkModes - 1);
+            break;
+        case kParamAutoRelease:
+            AutoReleaseKnob = value;
+            auto_release = (AutoReleaseKnob >= 0.5);
+            break;
+        case kParamTruePeak:
+            TruePeakKnob = value;           // switched in or out, with its latency, at the next resume()
+            break;
+        case kParamLimiter:
+            LimiterKnob = value;            // likewise
+            break;
+        case kParamCeiling:
+            CeilingKnob = value;
+            ceiling = dB2lin(SmartKnob::knob2value(CeilingKnob, CeilingLimits, CeilingTaper));
+            break;
         default :
+            if (index >= kParamBandThresh1 && index < kParamLookahead) {
+                BandThreshKnob[index - kParamBandThresh1] = value;
+                band_trim[index - kParamBandThresh1] = SmartKnob::knob2value(value, BandThreshLimits, BandThreshTaper);
+                bands_dirty = true;
+            }
             break;
 	}
 }
@@ -160,7 +504,48 @@ float Compressor::getParameter (VstInt32 index)
         case kParamDetectorExponent:
             return ExponentKnob;
             break;
+        case kParamBands:
+            return BandsKnob;
+            break;
+        case kParamXoverLow:
+            return XoverLowKnob;
+            break;
+        case kParamXoverHigh:
+            return XoverHighKnob;
+            break;
+        case kParamLookahead:
+            return LookaheadKnob;
+            break;
+        case kParamKeySource:
+            return KeySourceKnob;
+            break;
+        case kParamKeyFilter:
+            return KeyFilterKnob;
+            break;
+        case kParamKeyFreq:
+            return KeyFreqKnob;
+            break;
+        case kParamKeyQ:
+            return KeyQKnob;
+            break;
+        case kParamLink:
+            return LinkKnob;
+            break;
+        case kParamAutoRelease:
+            return AutoReleaseKnob;
+            break;
+        case kParamTruePeak:
+            return TruePeakKnob;
+            break;
+        case kParamCeiling:
+            return CeilingKnob;
+            break;
+        case kParamLimiter:
+            return LimiterKnob;
+            break;
         default :
+            if (index >= kParamBandThresh1 && index < kParamLookahead)
+                return BandThreshKnob[index - kParamBandThresh1];
             return 0.0;
 	}
 }
@@ -191,8 +576,52 @@ void Compressor::getParameterName (VstInt32 index, char* label)
         case kParamDetectorExponent:
             vst_strncpy(label, "Exponent ",kVstMaxParamStrLen);
             break;
+        case kParamBands:
+            vst_strncpy(label, "Bands ",kVstMaxParamStrLen);
+            break;
+        case kParamXoverLow:
+            vst_strncpy(label, "XLow ",kVstMaxParamStrLen);
+            break;
+        case kParamXoverHigh:
+            vst_strncpy(label, "XHigh ",kVstMaxParamStrLen);
+            break;
+        case kParamLookahead:
+            vst_strncpy(label, "Lookahd ",kVstMaxParamStrLen);
+            break;
+        case kParamKeySource:
+            vst_strncpy(label, "Key ",kVstMaxParamStrLen);
+            break;
+        case kParamKeyFilter:
+            vst_strncpy(label, "KeyFilt ",kVstMaxParamStrLen);
+            break;
+        case kParamKeyFreq:
+            vst_strncpy(label, "KeyFreq ",kVstMaxParamStrLen);
+            break;
+        case kParamKeyQ:
+            vst_strncpy(label, "Key Q ",kVstMaxParamStrLen);
+            break;
+        case kParamLink:
+            vst_strncpy(label, "Link ",kVstMaxParamStrLen);
+            break;
+        case kParamAutoRelease:
+            vst_strncpy(label, "AutoRel ",kVstMaxParamStrLen);
+            break;
+        case kParamTruePeak:
+            vst_strncpy(label, "TruePk ",kVstMaxParamStrLen);
+            break;
+        case kParamCeiling:
+            vst_strncpy(label, "Ceiling ",kVstMaxParamStrLen);
+            break;
+        case kParamLimiter:
+            vst_strncpy(label, "Limiter ",kVstMaxParamStrLen);
+            break;
         default :
-            *label = '\0';
+            if (index >= kParamBandThresh1 && index < kParamLookahead) {
+                char name[kVstMaxParamStrLen + 1];
+                snprintf(name, sizeof(name), "B%d Thr ", index - kParamBandThresh1 + 1);
+                vst_strncpy(label, name, kVstMaxParamStrLen);
+            } else
+                *label = '\0';
             break;
 	};
 }
@@ -223,8 +652,55 @@ void Compressor::getParameterDisplay (VstInt32 index, char* text)
         case kParamDetectorExponent:
             float2string(exponent, text, kVstMaxParamStrLen);
             break;
+        case kParamBands:
+            int2string(1 + (int)(BandsKnob*(kMaxBands-1) + 0.5), text, kVstMaxParamStrLen);
+            break;
+        case kParamXoverLow:
+            float2string(xover_low, text, kVstMaxParamStrLen);
+            break;
+        case kParamXoverHigh:
+            float2string(xover_high, text, kVstMaxParamStrLen);
+            break;
+        case kParamLookahead:
+            float2string(1000.0*lookahead_time, text, kVstMaxParamStrLen);
+            break;
+        case kParamKeySource:
+            vst_strncpy(text, key_external ? "Key In" : "Main In", kVstMaxParamStrLen);
+            break;
+        case kParamKeyFilter:
+            vst_strncpy(text, key_filter_type == kKeyFilterHP ? "HP" : key_filter_type == kKeyFilterBP ? "BP" : "Off",
+                        kVstMaxParamStrLen);
+            break;
+        case kParamKeyFreq:
+            float2string(key_freq, text, kVstMaxParamStrLen);
+            break;
+        case kParamKeyQ:
+            float2string(key_q, text, kVstMaxParamStrLen);
+            break;
+        case kParamLink:
+            if (num_bands > 1)
+                vst_strncpy(text, "Linked", kVstMaxParamStrLen);     // the bands always are
+            else
+                vst_strncpy(text, link_mode == kLinkLR ? "L/R" : link_mode == kLinkMS ? "M/S" : "Linked",
+                            kVstMaxParamStrLen);
+            break;
+        case kParamAutoRelease:
+            vst_strncpy(text, auto_release ? "On" : "Off", kVstMaxParamStrLen);
+            break;
+        case kParamTruePeak:
+            vst_strncpy(text, (TruePeakKnob >= 0.5) ? "On" : "Off", kVstMaxParamStrLen);
+            break;
+        case kParamCeiling:
+            float2string(dB(ceiling), text, kVstMaxParamStrLen);
+            break;
+        case kParamLimiter:
+            vst_strncpy(text, (LimiterKnob >= 0.5) ? "On" : "Off", kVstMaxParamStrLen);
+            break;
         default :
-            *text = '\0';
+            if (index >= kParamBandThresh1 && index < kParamLookahead)
+                float2string(band_trim[index - kParamBandThresh1], text, kVstMaxParamStrLen);
+            else
+                *text = '\0';
             break;
 	};
 }
@@ -255,8 +731,36 @@ void Compressor::getParameterLabel (VstInt32 index, char* label)
         case kParamDetectorExponent:
             vst_strncpy(label, " ", kVstMaxParamStrLen);
             break;
+        case kParamBands:
+            vst_strncpy(label, " ", kVstMaxParamStrLen);
+            break;
+        case kParamXoverLow:
+        case kParamXoverHigh:
+            vst_strncpy(label, "Hz", kVstMaxParamStrLen);
+            break;
+        case kParamLookahead:
+            vst_strncpy(label, "mSec", kVstMaxParamStrLen);
+            break;
+        case kParamKeySource:
+        case kParamKeyFilter:
+        case kParamKeyQ:
+        case kParamLink:
+        case kParamAutoRelease:
+        case kParamTruePeak:
+        case kParamLimiter:
+            vst_strncpy(label, " ", kVstMaxParamStrLen);
+            break;
+        case kParamKeyFreq:
+            vst_strncpy(label, "Hz", kVstMaxParamStrLen);
+            break;
+        case kParamCeiling:
+            vst_strncpy(label, "dBTP", kVstMaxParamStrLen);
+            break;
         default :
-            *label = '\0';
+            if (index >= kParamBandThresh1 && index < kParamLookahead)
+                vst_strncpy(label, "dB", kVstMaxParamStrLen);
+            else
+                *label = '\0';
             break;
 	};
 }
@@ -291,13 +795,32 @@ VstInt32 Compressor::getVendorVersion ()
 //-----------------------------------------------------------------------------------------
 void Compressor::processReplacing (float** inputs, float** outputs, VstInt32 sampleFrames)
 {
+    if (bands_dirty)
+        designBands();
+    if (lookahead_dirty) {
+        lookahead_dirty = false;
+        limiter.setWindow(lookaheadWindow());
+    }
+    limiter.ceiling = ceiling;                      // on the output, after the output gain
+    if (num_bands > 1 || link_mode != kLinkStereo) {
+        if (num_bands > 1)
+            processMultiband(inputs, outputs, sampleFrames);
+        else
+            processUnlinked(inputs, outputs, sampleFrames);
+        if (limiter_on)
+            limiter.process(outputs[0], outputs[1], sampleFrames);
+        return;
+    }
+    
     float* in1  =  inputs[0];
     float* in2  =  inputs[1];
     float* out1 = outputs[0];
     float* out2 = outputs[1];
     
-    float level_estimate, log_level;
-    float tot0;
+    float level_estimate, log2level;
+    float x, tot0;
+    double key0, key1;
+    bool keyed = key_external || key_filter_type != kKeyFilterOff;
     
 	for (int i = 0; i < sampleFrames; i++)
 	{
@@ -321,25 +844,49 @@ void Compressor::processReplacing (float** inputs, float** outputs, VstInt32 sam
         
         ////////////////////////////////////////////////////////////////////////////
         // TODO - Problem 3: replace the peak-detection scheme with an RMp detector
-        tot0 = powf((fabs(inp0) + fabs(inp1))/2,exponent);
-        peak_detector.process_RMS_pnorm(tot0, level_estimate);
-        level_estimate = powf(level_estimate,1/exponent);
+        // the level is kept as log2 from here on, so the 1/p root is a multiply
+        if (true_peak) {
+            // the key at 4x, on and between its samples; the audio is delayed to meet it
+            float peak0, peak1;
+            if (keyed)
+                keySignal(inp0, inp1, inputs, i, key0, key1);
+            else {
+                key0 = inp0;
+                key1 = inp1;
+            }
+            true_peak_detector.process(key0, key1, peak0, peak1);
+            x = (peak0 + peak1)*0.5f;
+            alignWithTruePeak(inp0, inp1);
+        } else if (keyed) {
+            keySignal(inp0, inp1, inputs, i, key0, key1);
+            x = (fabs(key0) + fabs(key1))*0.5;
+        } else
+            x = (fabsf(inp0) + fabsf(inp1))*0.5f;
+        if (detector_power == 1)
+            tot0 = x;
+        else if (detector_power == 2)
+            tot0 = x*x;
+        else
+            tot0 = fastExp2(exponent*fastLog2(x));
+        if (auto_release)
+            peak_detector.process_adaptive(tot0, level_estimate);
+        else
+            peak_detector.process_RMS_pnorm(tot0, level_estimate);
+        log2level = fastLog2(level_estimate)*inv_exponent;
         ////////////////////////////////////////////////////////////////////////////
         
         
 		/////////////  GAIN COMPUTER  ///////////////////
-        log_level = dB(level_estimate);
         
-        // limiter setup
-        dbgainval = min(0.0, dB(threshold/level_estimate));
-
         ////////////////////////////////////////////////////////////////////////////
         // TODO - Problem 2: implement the gain computer logic here, to turn the 
         //                   limiter into a basic compressor
+        float log2gain = gainComputer(log2level, log2thresh);
+        dbgainval = log2gain*kDBPerLog2;
         ////////////////////////////////////////////////////////////////////////////
         
 		// Compute linear gain for compressor
-		gainval = dB2lin(dbgainval);		
+		gainval = fastExp2(log2gain);
 		
 		// Apply compressor gain and output gain to signal
 		*out1++ = inp0*gainval*output_gain;
@@ -350,4 +897,126 @@ void Compressor::processReplacing (float** inputs, float** outputs, VstInt32 sam
         
         
 	}
+    
+    if (limiter_on)
+        limiter.process(outputs[0], outputs[1], sampleFrames);
+}
+
+//-----------------------------------------------------------------------------------------
+// Left and right, or mid and side, each with its own detector and gain: the two run side by side
+// in StereoDetector, and mid/side is decoded back to left/right after the gains
+void Compressor::processUnlinked (float** inputs, float** outputs, VstInt32 sampleFrames)
+{
+    float* in1  =  inputs[0];
+    float* in2  =  inputs[1];
+    float* out1 = outputs[0];
+    float* out2 = outputs[1];
+    
+    double key0, key1;
+    float g0 = 1.0f, g1 = 1.0f;
+    bool keyed = key_external || key_filter_type != kKeyFilterOff;
+    bool ms = (link_mode == kLinkMS);
+    
+    stereo_detector.setFrom(peak_detector, auto_release, detector_power, exponent, log2thresh, comp_slope);
+    
+	for (int i = 0; i < sampleFrames; i++)
+	{
+		float inp0 = in1[i]*input_gain;
+		float inp1 = in2[i]*input_gain;
+		if (keyed)
+			keySignal(inp0, inp1, inputs, i, key0, key1);
+		else {
+			key0 = inp0;
+			key1 = inp1;
+		}
+		
+		float d0 = ms ? (key0 + key1)*0.5 : key0;
+		float d1 = ms ? (key0 - key1)*0.5 : key1;
+		float x0 = fabsf(d0), x1 = fabsf(d1);
+		if (true_peak) {
+			true_peak_detector.process(d0, d1, x0, x1);
+			alignWithTruePeak(inp0, inp1);
+		}
+		stereo_detector.process(x0, x1, g0, g1);
+		
+		float a0 = inp0, a1 = inp1;
+		if (ms) {
+			a0 = (inp0 + inp1)*0.5f;
+			a1 = (inp0 - inp1)*0.5f;
+		}
+		a0 *= g0;
+		a1 *= g1;
+		
+		out1[i] = (ms ? a0 + a1 : a0)*output_gain;
+		out2[i] = (ms ? a0 - a1 : a1)*output_gain;
+	}
+	
+	gainval = min(g0, g1);
+	dbgainval = dB(gainval);
+}
+
+//-----------------------------------------------------------------------------------------
+// Every band of both channels goes through the crossover sections and the detectors together; the
+// gain computer runs every kMBGainInterval frames per band, and each band's gain ramps linearly to
+// the new value in between.
+void Compressor::processMultiband (float** inputs, float** outputs, VstInt32 sampleFrames)
+{
+    float* in1  =  inputs[0];
+    float* in2  =  inputs[1];
+    float* out1 = outputs[0];
+    float* out2 = outputs[1];
+    
+    double bands[kBandLanes], keyBands[kBandLanes], peaks[kBandLanes];
+    double key0, key1;
+    int b;
+    bool keyed = key_external || key_filter_type != kKeyFilterOff;
+    memset(peaks, 0, sizeof(peaks));          // the unused lanes stay quiet
+    
+    // the full-band detector law, so p and AutoRel act on every band; Link doesn't apply, every band
+    // is linked across the channels
+    band_detectors.setFrom(peak_detector, auto_release, detector_power, exponent);
+    
+	for (int i = 0; i < sampleFrames; i++)
+	{
+		float inp0 = in1[i]*input_gain;
+		float inp1 = in2[i]*input_gain;
+		crossover.process(inp0, inp1, bands);
+		const double* key = bands;
+		if (keyed) {
+			// each band follows the key's level in that band
+			keySignal(inp0, inp1, inputs, i, key0, key1);
+			key_crossover.process(key0, key1, keyBands);
+			key = keyBands;
+		}
+		if (true_peak) {
+			// each band's key at 4x; the bands are delayed to meet the readings
+			for (b = 0; b < num_bands; b++) {
+				float peak0, peak1;
+				band_true_peak[b].process(key[2*b], key[2*b + 1], peak0, peak1);
+				peaks[2*b] = peak0;
+				peaks[2*b + 1] = peak1;
+			}
+			alignBandsWithTruePeak(bands);
+			key = peaks;
+		}
+		band_detectors.process(key);
+        
+		if (--gain_count <= 0) {
+			gain_count = kMBGainInterval;
+			for (b = 0; b < num_bands; b++) {
+				float log2level = fastLog2(band_detectors.levelEstimate[b])*inv_exponent;
+				double target = (log2level > band_log2thresh[b]) ? fastExp2(gainComputer(log2level, band_log2thresh[b])) : 1.0;
+				band_step[b] = (target - band_gain[b])*(1.0/kMBGainInterval);
+			}
+		}
+        
+		double acc0 = 0.0, acc1 = 0.0;
+		for (b = 0; b < num_bands; b++) {
+			acc0 += bands[2*b]*band_gain[b];
+			acc1 += bands[2*b + 1]*band_gain[b];
+			band_gain[b] += band_step[b];
+		}
+		out1[i] = acc0*output_gain;
+		out2[i] = acc1*output_gain;
+	}
 }
@@ -5,7 +5,14 @@
 // Created by   : Regina Collecchia + music424 staff
 // Company      : CCRMA - Stanford
 // Description  : Lab 1 for MUSIC 424. Implements a compressor plugin with a few different methods for
-//                peak detection: linear, RMS, and RMS p-norm peak detection.
+//                peak detection: linear, RMS, and RMS p-norm peak detection. With Bands above 1 it
+//                splits the signal with Linkwitz-Riley crossovers and compresses each band on its own.
+//                The Limiter switch adds a brickwall lookahead limiter after either one, its ceiling
+//                set on its own in dBTP and applied after the output gain.
+//                The detector can listen to a second stereo input, the key, instead of the main one,
+//                and either one through a highpass or bandpass key filter. The full-band detector
+//                can be linked, run on left and right separately, or on mid and side, and its
+//                release can follow the program (fast on transients, slow on dense material).
 // Date         : 4/13/14
 //-------------------------------------------------------------------------------------------------------
 
@@ -15,6 +22,7 @@
 #include "public.sdk/source/vst2.x/audioeffectx.h"
 
 #include <math.h>
+#include "FastMath.h"
 
 #ifndef max
 #define max(a,b)			(((a) > (b)) ? (a) : (b))
@@ -34,6 +42,50 @@
 #endif
 
 #define kMaxLen             32
+#define kMBGainInterval     8           // frames between multiband gain computer updates
+
+// program-dependent release: a fast and a slow envelope, blended by the crest factor of the slow one
+// over the average level. At kCrestLow and below it is all slow, at kCrestHigh and above all fast.
+#define kFastReleaseRatio   0.1         // fast release time re the release knob
+#define kCrestTime          0.3         // seconds, the average the crest factor is taken against
+#define kCrestLow           2.0         // 6 dB
+#define kCrestHigh          8.0         // 18 dB
+
+
+//-------------------------------------------------------------------------------------------------------
+// signal processing functions
+struct Biquad {
+    //  biquad filter section
+    double	b0, b1, b2, a1, a2, z1, z2;
+    
+    Biquad() {
+        this->b0=1.0;
+        this->b1=0.0;
+        this->b2=0.0;
+        this->a1=0.0;
+        this->a2=0.0;
+        reset();
+    }
+    void setCoefs(double* coefs) {
+        // set filter coefficients [b0 b1 b2 a1 a2]
+        this->b0=*(coefs);
+        this->b1=*(coefs+1);
+        this->b2=*(coefs+2);
+        this->a1=*(coefs+3);
+        this->a2=*(coefs+4);
+    }
+    void reset() {
+        // reset filter state
+        z1=0;
+        z2=0;
+    }
+    void process (double input, double& output) {
+        // process input sample, direct form II transposed
+        output = z1 + input*b0;
+        z1 = z2 + input*b1 - output*a1;
+        z2 = input*b2 - output*a2;
+    }
+};
 
 
 //-------------------------------------------------------------------------------------------------------
@@ -41,6 +93,8 @@
 struct PeakDetector {
 	
 	float	b0_r, a1_r, b0_a, a1_a, p, levelEstimate;
+	float	b0_rf, b0_m, crestLow, crestSpan;                   // program-dependent release
+	float	fastEstimate, slowEstimate, meanEstimate;
 	
 	PeakDetector() {
 		
@@ -50,12 +104,17 @@ struct PeakDetector {
 		this->a1_a = 0; // attack coeffs
 		this->b0_a = 1;
         this->p = 1;
+        this->b0_rf = 1;
+        this->b0_m = 1;
+        setExponent(1, 0);
 		reset();
 	}
 	
 	void setTauRelease(float tauRelease, float fs) {
 		a1_r = exp( -1.0 / ( tauRelease * fs ) );
 		b0_r = 1 - a1_r;
+		b0_rf = 1 - exp( -1.0 / ( kFastReleaseRatio * tauRelease * fs ) );
+		b0_m = 1 - exp( -1.0 / ( kCrestTime * fs ) );
 	}
     
 	void setTauAttack(float tauAttack, float fs) {
@@ -65,18 +124,23 @@ struct PeakDetector {
     
     void setExponent(float ex, float fs) {
         p = 1.0f/ex;
+        crestLow = pow(kCrestLow, ex);          // the detector input is |x|^ex
+        crestSpan = pow(kCrestHigh, ex) - crestLow;
     }
 	
 	void reset() {
 		// reset filter state
 		levelEstimate=0;
+		fastEstimate=0;
+		slowEstimate=0;
+		meanEstimate=0;
 	}
 	
+	// attack or release without a branch: only one of the two terms is nonzero, so this is the
+	// same arithmetic as picking the coefficient
 	void process (float input, float& output) {        
-		if ( fabs( input ) > levelEstimate )
-            levelEstimate += b0_a * ( fabs( input ) - levelEstimate );
-        else
-            levelEstimate += b0_r * ( fabs( input ) - levelEstimate );
+		float d = fabs( input ) - levelEstimate;
+        levelEstimate += b0_a * max( d, 0.0f ) + b0_r * min( d, 0.0f );
         output = levelEstimate;
 	}
 
@@ -89,9 +153,158 @@ struct PeakDetector {
         levelEstimate += b0_r * ( fabs( input ) - levelEstimate );
         output = levelEstimate;
 	}
+    
+    // program-dependent release, input >= 0: the fast and slow envelopes attack alike, and the
+    // output moves from the slow one to the fast one as the crest factor goes up
+    void process_adaptive (float input, float& output) {
+        float d = input - fastEstimate;
+        fastEstimate += b0_a * max( d, 0.0f ) + b0_rf * min( d, 0.0f );
+        d = input - slowEstimate;
+        slowEstimate += b0_a * max( d, 0.0f ) + b0_r * min( d, 0.0f );
+        meanEstimate += b0_m * ( input - meanEstimate );
+        float w = ( slowEstimate - crestLow * meanEstimate ) / ( crestSpan * meanEstimate + 1e-30f );
+        w = min( max( w, 0.0f ), 1.0f );
+        levelEstimate = slowEstimate + w * ( fastEstimate - slowEstimate );
+        output = levelEstimate;
+	}
+
+};
 
+
+//-------------------------------------------------------------------------------------------------------
+// The full-band detector and gain computer for two signals at once (left and right, or mid and
+// side), one per SIMD lane, so the unlinked modes cost about what the linked one does
+struct StereoDetector {
+	
+	float	b0_r, p, invP, log2thresh, slope;
+	float	b0_a, b0_rf, b0_m, crestLow, crestSpan;
+	int		power;                  // 1 or 2 when p is, 0 for any other p
+	bool	adaptive;               // program-dependent release, as PeakDetector::process_adaptive()
+	float	levelEstimate[4];       // lanes 0 and 1 in use, 2 and 3 follow them
+	float	fastEstimate[4], slowEstimate[4], meanEstimate[4];
+	
+	StereoDetector() {
+		b0_r = 1;                   // default to pass-through
+		b0_a = b0_rf = b0_m = 1;
+		crestLow = crestSpan = 1;
+		p = invP = 1;
+		power = 1;
+		adaptive = false;
+		log2thresh = 0;
+		slope = 1;
+		reset();
+	}
+	
+	// the same detector and gain computer settings as the linked path
+	void setFrom(const PeakDetector& pd, bool adaptiveRelease, int detectorPower, float exponent, float thresh,
+				 float compSlope) {
+		b0_r = pd.b0_r;
+		b0_a = pd.b0_a;
+		b0_rf = pd.b0_rf;
+		b0_m = pd.b0_m;
+		crestLow = pd.crestLow;
+		crestSpan = pd.crestSpan;
+		adaptive = adaptiveRelease;
+		power = detectorPower;
+		p = exponent;
+		invP = 1.0f/exponent;
+		log2thresh = thresh;
+		slope = compSlope;
+	}
+	
+	void reset() {
+		memset(levelEstimate, 0, sizeof(levelEstimate));
+		memset(fastEstimate, 0, sizeof(fastEstimate));
+		memset(slowEstimate, 0, sizeof(slowEstimate));
+		memset(meanEstimate, 0, sizeof(meanEstimate));
+	}
+	
+	// detector inputs x0, x1 (magnitudes) in, linear gains g0, g1 out
+	void process(float x0, float x1, float& g0, float& g1) {
+#if defined(FM_SSE2)
+		__m128 x = _mm_setr_ps(x0, x1, x0, x1), lev = _mm_loadu_ps(levelEstimate);     // lanes 2, 3 copy 0, 1
+		__m128 tot = (power == 1) ? x : (power == 2) ? _mm_mul_ps(x, x)
+					 : fastExp2x4(_mm_mul_ps(_mm_set1_ps(p), fastLog2x4(x)));
+		if (adaptive) {
+			__m128 zero = _mm_setzero_ps(), ba = _mm_set1_ps(b0_a);
+			__m128 f = _mm_loadu_ps(fastEstimate), s = _mm_loadu_ps(slowEstimate), m = _mm_loadu_ps(meanEstimate);
+			__m128 d = _mm_sub_ps(tot, f);
+			f = _mm_add_ps(f, _mm_add_ps(_mm_mul_ps(ba, _mm_max_ps(d, zero)), _mm_mul_ps(_mm_set1_ps(b0_rf), _mm_min_ps(d, zero))));
+			d = _mm_sub_ps(tot, s);
+			s = _mm_add_ps(s, _mm_add_ps(_mm_mul_ps(ba, _mm_max_ps(d, zero)), _mm_mul_ps(_mm_set1_ps(b0_r), _mm_min_ps(d, zero))));
+			m = _mm_add_ps(m, _mm_mul_ps(_mm_set1_ps(b0_m), _mm_sub_ps(tot, m)));
+			__m128 w = _mm_div_ps(_mm_sub_ps(s, _mm_mul_ps(_mm_set1_ps(crestLow), m)),
+								  _mm_add_ps(_mm_mul_ps(_mm_set1_ps(crestSpan), m), _mm_set1_ps(1e-30f)));
+			w = _mm_min_ps(_mm_max_ps(w, zero), _mm_set1_ps(1.0f));
+			lev = _mm_add_ps(s, _mm_mul_ps(w, _mm_sub_ps(f, s)));
+			_mm_storeu_ps(fastEstimate, f);
+			_mm_storeu_ps(slowEstimate, s);
+			_mm_storeu_ps(meanEstimate, m);
+		} else
+			lev = _mm_add_ps(lev, _mm_mul_ps(_mm_set1_ps(b0_r), _mm_sub_ps(tot, lev)));
+		_mm_storeu_ps(levelEstimate, lev);
+		__m128 log2level = _mm_mul_ps(fastLog2x4(lev), _mm_set1_ps(invP));
+		__m128 gain = _mm_mul_ps(_mm_min_ps(_mm_set1_ps(0.0f), _mm_sub_ps(_mm_set1_ps(log2thresh), log2level)),
+								 _mm_set1_ps(slope));
+		gain = fastExp2x4(gain);
+		g0 = _mm_cvtss_f32(gain);
+		g1 = _mm_cvtss_f32(_mm_shuffle_ps(gain, gain, 1));
+#elif defined(FM_NEON)
+		float32x2_t pair = vset_lane_f32(x1, vdup_n_f32(x0), 1);
+		float32x4_t x = vcombine_f32(pair, pair), lev = vld1q_f32(levelEstimate);
+		float32x4_t tot = (power == 1) ? x : (power == 2) ? vmulq_f32(x, x)
+						  : fastExp2x4(vmulq_f32(vdupq_n_f32(p), fastLog2x4(x)));
+		if (adaptive) {
+			float32x4_t zero = vdupq_n_f32(0.0f), ba = vdupq_n_f32(b0_a);
+			float32x4_t f = vld1q_f32(fastEstimate), s = vld1q_f32(slowEstimate), m = vld1q_f32(meanEstimate);
+			float32x4_t d = vsubq_f32(tot, f);
+			f = vaddq_f32(f, vaddq_f32(vmulq_f32(ba, vmaxq_f32(d, zero)), vmulq_f32(vdupq_n_f32(b0_rf), vminq_f32(d, zero))));
+			d = vsubq_f32(tot, s);
+			s = vaddq_f32(s, vaddq_f32(vmulq_f32(ba, vmaxq_f32(d, zero)), vmulq_f32(vdupq_n_f32(b0_r), vminq_f32(d, zero))));
+			m = vaddq_f32(m, vmulq_f32(vdupq_n_f32(b0_m), vsubq_f32(tot, m)));
+			float32x4_t w = vdivq_f32(vsubq_f32(s, vmulq_f32(vdupq_n_f32(crestLow), m)),
+									  vaddq_f32(vmulq_f32(vdupq_n_f32(crestSpan), m), vdupq_n_f32(1e-30f)));
+			w = vminq_f32(vmaxq_f32(w, zero), vdupq_n_f32(1.0f));
+			lev = vaddq_f32(s, vmulq_f32(w, vsubq_f32(f, s)));
+			vst1q_f32(fastEstimate, f);
+			vst1q_f32(slowEstimate, s);
+			vst1q_f32(meanEstimate, m);
+		} else
+			lev = vaddq_f32(lev, vmulq_f32(vdupq_n_f32(b0_r), vsubq_f32(tot, lev)));
+		vst1q_f32(levelEstimate, lev);
+		float32x4_t log2level = vmulq_f32(fastLog2x4(lev), vdupq_n_f32(invP));
+		float32x4_t gain = vmulq_f32(vminq_f32(vdupq_n_f32(0.0f), vsubq_f32(vdupq_n_f32(log2thresh), log2level)),
+									 vdupq_n_f32(slope));
+		gain = fastExp2x4(gain);
+		g0 = vgetq_lane_f32(gain, 0);
+		g1 = vgetq_lane_f32(gain, 1);
+#else
+		float in[2] = {x0, x1}, g[2];
+		for (int c = 0; c < 2; c++) {
+			float tot = (power == 1) ? in[c] : (power == 2) ? in[c]*in[c] : fastExp2(p*fastLog2(in[c]));
+			if (adaptive) {
+				float d = tot - fastEstimate[c];
+				fastEstimate[c] += b0_a*max(d, 0.0f) + b0_rf*min(d, 0.0f);
+				d = tot - slowEstimate[c];
+				slowEstimate[c] += b0_a*max(d, 0.0f) + b0_r*min(d, 0.0f);
+				meanEstimate[c] += b0_m*(tot - meanEstimate[c]);
+				float w = (slowEstimate[c] - crestLow*meanEstimate[c])/(crestSpan*meanEstimate[c] + 1e-30f);
+				w = min(max(w, 0.0f), 1.0f);
+				levelEstimate[c] = slowEstimate[c] + w*(fastEstimate[c] - slowEstimate[c]);
+			} else
+				levelEstimate[c] += b0_r*(tot - levelEstimate[c]);
+			g[c] = fastExp2(min(0.0f, log2thresh - fastLog2(levelEstimate[c])*invP)*slope);
+		}
+		g0 = g[0];
+		g1 = g[1];
+#endif
+	}
 };
 
+#include "Multiband.h"
+#include "TruePeak.h"
+#include "Lookahead.h"
+
 
 //-------------------------------------------------------------------------------------------------------
 // The VST plug-in
@@ -103,6 +316,9 @@ public:
     
 	// Processing
 	virtual void processReplacing (float** inputs, float** outputs, VstInt32 sampleFrames);
+	virtual void setSampleRate (float sampleRate);
+	virtual void resume ();
+	virtual bool getInputProperties (VstInt32 index, VstPinProperties* properties);
     
 	// Program
 	virtual void setProgramName (char* name);
@@ -115,12 +331,28 @@ public:
 	virtual void getParameterDisplay (VstInt32 index, char* text);
 	virtual void getParameterName (VstInt32 index, char* text);
     
+	void bilinearTransform(double acoefs[], double dcoeffs[]);
+	void designKeyFilter();
+    
 	virtual bool getEffectName (char* name);
 	virtual bool getVendorString (char* text);
 	virtual bool getProductString (char* text);
 	virtual VstInt32 getVendorVersion ();
     
 protected:
+	void processMultiband (float** inputs, float** outputs, VstInt32 sampleFrames);
+	void designBands ();                 // crossovers and band thresholds from the knobs
+	long lookaheadWindow ();             // limiter window for the lookahead knob, frames
+	long maxLookaheadWindow ();          // and for the top of its range
+	void keySignal (float inp0, float inp1, float** inputs, int i, double& key0, double& key1);
+	void processUnlinked (float** inputs, float** outputs, VstInt32 sampleFrames);
+	float gainComputer (float log2level, float log2thresh);     // log2 gain for a log2 level
+	void setExponent (float ex);         // detector exponent p, and its fast path
+	long latency ();                     // frames of delay the host should make up for
+	void alignWithTruePeak (float& inp0, float& inp1);
+	void alignBandsWithTruePeak (double* bands);
+	void resetTruePeak ();               // true-peak detectors and audio delays back to silence
+
 	// param IDs
 	enum {
 		kParamInputGain	= 0,
@@ -130,9 +362,39 @@ protected:
 		kParamRatio,
 		kParamOutputGain,
         kParamDetectorExponent,
+        kParamBands,
+        kParamXoverLow,
+        kParamXoverHigh,
+        kParamBandThresh1,              // kMaxBands of these, one per band
+        kParamLookahead = kParamBandThresh1 + kMaxBands,
+        kParamKeySource,
+        kParamKeyFilter,
+        kParamKeyFreq,
+        kParamKeyQ,
+        kParamLink,
+        kParamAutoRelease,
+        kParamTruePeak,
+        kParamCeiling,
+        kParamLimiter,
 		kNumParams
 	};
     
+	// link modes of the full-band detector
+	enum {
+		kLinkStereo = 0,            // one detector on the average of the two channels
+		kLinkLR,                    // left and right on their own
+		kLinkMS,                    // mid and side on their own
+		kNumLinkModes
+	};
+    
+	// key filter types
+	enum {
+		kKeyFilterOff = 0,
+		kKeyFilterHP,
+		kKeyFilterBP,
+		kNumKeyFilters
+	};
+    
     
 	// knob vars
 	float InputGainKnob;
@@ -142,11 +404,25 @@ protected:
 	float ThresholdKnob;
     float RatioKnob;
 	float OutputGainKnob;
+    float BandsKnob;
+    float XoverLowKnob;
+    float XoverHighKnob;
+    float BandThreshKnob[kMaxBands];
+    float LookaheadKnob;
+    float KeySourceKnob;
+    float KeyFilterKnob;
+    float KeyFreqKnob;
+    float KeyQKnob;
+    float LinkKnob;
+    float AutoReleaseKnob;
+    float TruePeakKnob;
+    float CeilingKnob;
+    float LimiterKnob;
 	
 	// config
 	enum { 
 		kNumProgs	= 1,
-		kNumInputs	= 2,       // our process replacing assumes stereo inputs
+		kNumInputs	= 4,       // main L R, then the key L R
 		kNumOutputs	= 2
 	};
     
@@ -161,13 +437,57 @@ protected:
 	float attack_time;        // attack time in seconds
 	float release_time;       // release time in seconds
     float exponent;           // value for exponent p
+    float inv_exponent;       // 1/p
+    int detector_power;       // 1 or 2 when p is, 0 for any other p
 	float threshold;          // compression threshold in linear scale
 	float logthresh;          // compression threshold in logarithmic scale
+	float log2thresh;         // and as log2 of the amplitude, for the gain computer
 	float comp_ratio;         // compression ratio
+    float comp_slope;         // dB of gain reduction per dB over the threshold
     float gainval;            // compressor's gain computer gain in linear scale
 	float dbgainval;          // compressor's gain computer gain in dB scale
     
     PeakDetector peak_detector;
+    StereoDetector stereo_detector;         // the unlinked modes
+    int link_mode;
+    bool auto_release;        // program-dependent release in place of the fixed one
+
+    // true-peak detection, switched in and out by resume(): the detectors read the key at 4x, between the samples as well as on them,
+    // and the audio is held back kTruePeakDelay frames to meet the readings. In multiband mode each
+    // band's key has its own reading, and the bands are held back before their gains.
+    bool true_peak;
+    TruePeakDetector true_peak_detector;
+    float true_peak_delay[kTruePeakDelay][2];
+    TruePeakDetector band_true_peak[kMaxBands];
+    double band_delay[kTruePeakDelay][kBandLanes];
+    int true_peak_pos;                      // in either delay, only one is in use at a time
+
+    // multiband mode
+    int num_bands;            // 1 runs the full-band compressor above
+    double xover_low, xover_high;           // lowest and highest crossover, Hz
+    float band_trim[kMaxBands];             // band thresholds re the main threshold, dB
+    float band_thresh[kMaxBands];           // band thresholds, linear
+    float band_log2thresh[kMaxBands];       // and log2
+    LRCrossoverBank crossover;
+    PeakDetectorBank band_detectors;
+    double band_gain[kMaxBands], band_step[kMaxBands];  // gain ramps between gain computer updates
+    int gain_count;                         // frames until the next update
+    bool bands_dirty;                       // knobs moved, redesign at the next block
+
+    // lookahead limiter, switched in and out by resume(), where the host hears about its latency
+    bool limiter_on;
+    float lookahead_time;                   // seconds
+    LookaheadLimiter limiter;
+    float ceiling;                          // limiter ceiling after the output gain, linear
+    bool lookahead_dirty;                   // new window at the next block
+
+    // key (sidechain)
+    bool key_external;        // detect from inputs 3 and 4 rather than the main input
+    int key_filter_type;      // kKeyFilterOff, HP or BP
+    float key_freq;           // key filter cutoff or centre, Hz
+    float key_q;              // key filter resonance
+    Biquad key_filter[2];
+    LRCrossoverBank key_crossover;          // the key's bands, for the multiband detectors
 };
 
 
@@ -198,10 +518,36 @@ const static float RRateTaper = -1.0;
 const static float ERateLimits[2] = {1, 10};
 const static float ERateTaper = -1.0;
 
-// Compression ratio limits; taper, exponent
+// Compression ratio limits; taper, exponent. The top of the range is a limiter.
 const static float RatioLimits[2] = {1, 100.0};
 const static float RatioTaper = -1.0;
 
+// Multiband: the bands-1 crossovers are spread geometrically from the low one to the high one, Hz
+const static float XoverLowLimits[2] = {40.0, 1000.0};
+const static float XoverLowTaper = -1.0;
+const static float XoverHighLimits[2] = {1000.0, 16000.0};
+const static float XoverHighTaper = -1.0;
+
+// per-band threshold offsets, dB; taper, exponent
+const static float BandThreshLimits[2] = {-12.0, 12.0};
+const static float BandThreshTaper = 1.0;
+
+// key filter frequency limits, Hz; taper, exponent
+const static float KeyFreqLimits[2] = {20.0, 10000.0};
+const static float KeyFreqTaper = -1.0;
+
+// key filter resonance limits; taper, exponent
+const static float KeyQLimits[2] = {0.5, 10.0};
+const static float KeyQTaper = -1.0;
+
+// lookahead limits, seconds; taper, exponent
+const static float LookaheadLimits[2] = {0.0, kMaxLookahead};
+const static float LookaheadTaper = 1.0;
+
+// limiter ceiling limits, dBTP; taper, exponent
+const static float CeilingLimits[2] = {-24.0, 0.0};
+const static float CeilingTaper = 1.0;
+
 
 // "static" class to faciliate the knob handling
 class SmartKnob {
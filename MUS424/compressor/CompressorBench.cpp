@@ -0,0 +1,235 @@
+//-------------------------------------------------------------------------------------------------------
+// Command-line tool
+//
+// Filename     : CompressorBench.cpp
+// Created by   : music424 staff
+// Company      : CCRMA - Stanford
+// Description  : Accuracy against speed for the Compressor's fast level and gain math. Checks
+//                fastLog2()/fastExp2() against libm over their whole range, then runs the plug-in
+//                next to a copy of it that still does the per-sample powf/log10/pow math, on the
+//                same noise, and reports how far apart the two outputs get in dB and what each
+//                costs per frame. Exits with status 1 if the gain error is above the tolerance.
+//
+//                g++ -O2 -D__cdecl= -I../../ReverbVST/vst_sdk
+//                    -I../../ReverbVST/vst_sdk/pluginterfaces/vst2.x
+//                    CompressorBench.cpp Compressor.cpp
+//                    ../../ReverbVST/vst_sdk/public.sdk/source/vst2.x/audioeffect.cpp
+//                    ../../ReverbVST/vst_sdk/public.sdk/source/vst2.x/audioeffectx.cpp
+//                    -o CompressorBench
+//
+//                CompressorBench [options]
+//                  -r rate       sample rate, Hz (48000)
+//                  -s seconds    length of the test signal (4)
+//                  -b frames     host block size (256)
+//                  -n passes     renders to time, the fastest is reported (3)
+//                  -p index=knob any parameter, knob on [0,1]
+//                  -tol dB       largest gain error allowed (0.001)
+//
+//                The plug-in is run with the detector exponent at 1, 2 (the two fast paths) and
+//                3.5. The summary goes to stdout as "name: value" lines.
+// Date         : 10/17/26
+//-------------------------------------------------------------------------------------------------------
+
+#include "Compressor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define kNumExponents       3
+#define kParamExponent      6           // Compressor's detector exponent parameter
+
+
+//-------------------------------------------------------------------------------------------------------
+// The full-band path as it was before the fast kernels: a power function each way through the
+// detector, and the gain computer in dB.
+class ReferenceCompressor : public Compressor
+{
+public:
+	ReferenceCompressor () : Compressor(0) {}
+
+	virtual void processReplacing (float** inputs, float** outputs, VstInt32 sampleFrames)
+	{
+		float* in1  =  inputs[0];
+		float* in2  =  inputs[1];
+		float* out1 = outputs[0];
+		float* out2 = outputs[1];
+		float level_estimate, tot0;
+		if (lookahead_dirty) {
+			lookahead_dirty = false;
+			limiter.setWindow(lookaheadWindow());
+		}
+		limiter.ceiling = ceiling;
+		for (int i = 0; i < sampleFrames; i++) {
+			float inp0 = in1[i]*input_gain;
+			float inp1 = in2[i]*input_gain;
+			tot0 = powf((fabs(inp0) + fabs(inp1))/2, exponent);
+			peak_detector.process_RMS_pnorm(tot0, level_estimate);
+			level_estimate = powf(level_estimate, 1/exponent);
+			float dbgain = min(0.0, dB(threshold/level_estimate))*comp_slope;
+			float gain = dB2lin(dbgain);
+			out1[i] = inp0*gain*output_gain;
+			out2[i] = inp1*gain*output_gain;
+		}
+		// the same limiter after it as the plug-in, so the outputs line up
+		if (limiter_on)
+			limiter.process(outputs[0], outputs[1], sampleFrames);
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------------
+// n frames through c in blocks, passes times; returns the fastest pass's ns per frame
+static double render(Compressor* c, float** x, float** y, long n, int block, int passes)
+{
+	double best = 0.0;
+	for (int p=0; p<passes; p++) {
+		c->resume();
+		clock_t t0 = clock();
+		for (long i=0; i<n; i+=block) {
+			int frames = (int)min((long)block, n - i);
+			float* in[2] = {x[0] + i, x[1] + i};
+			float* out[2] = {y[0] + i, y[1] + i};
+			c->processReplacing(in, out, frames);
+		}
+		double cost = (double)(clock() - t0)/CLOCKS_PER_SEC;
+		if (p == 0 || cost < best)
+			best = cost;
+	}
+	return best*1e9/n;
+}
+
+// largest error of the fast kernels over a sweep of their range: log2 in log2 units, exp2 relative
+static void kernelErrors(double& log2Error, double& exp2Error)
+{
+	log2Error = exp2Error = 0.0;
+	for (float x = 1.1754944e-38f; x < 1e30f; x *= 1.0001f) {
+		double e = fabs(fastLog2(x) - log2((double)x));
+		if (e > log2Error)
+			log2Error = e;
+	}
+	for (float x = -125.0f; x < 127.0f; x += 0.0001f) {
+		double ref = exp2((double)x);
+		double e = fabs(fastExp2(x) - ref)/ref;
+		if (e > exp2Error)
+			exp2Error = e;
+	}
+}
+
+// ns per call of a level-to-gain round trip, libm and fast, over the levels in x
+static void kernelCost(const float* x, long n, double& libmNs, double& fastNs)
+{
+	volatile float sink = 0.0f;
+	float acc = 0.0f;
+	clock_t t0 = clock();
+	for (long i=0; i<n; i++)
+		acc += dB2lin(0.5*dB(x[i]));
+	libmNs = (double)(clock() - t0)/CLOCKS_PER_SEC*1e9/n;
+	sink = acc;
+	acc = 0.0f;
+	t0 = clock();
+	for (long i=0; i<n; i++)
+		acc += fastExp2(0.5f*fastLog2(x[i]));
+	fastNs = (double)(clock() - t0)/CLOCKS_PER_SEC*1e9/n;
+	sink = acc;
+	(void)sink;
+}
+
+
+//-------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	double fs = 48000.0, seconds = 4.0, tolerance = 0.001;
+	int block = 256, passes = 3;
+	int numKnobs = 0, knobIndex[16];
+	float knobValue[16];
+
+	for (int a=1; a<argc; a++) {
+		const char* opt = argv[a];
+		const char* arg = (a+1 < argc) ? argv[a+1] : 0;
+		if (!arg) {
+			fprintf(stderr, "CompressorBench: %s needs a value (see the top of CompressorBench.cpp)\n", opt);
+			return 1;
+		}
+		a++;
+		if (!strcmp(opt, "-r"))					fs = atof(arg);
+		else if (!strcmp(opt, "-s"))			seconds = atof(arg);
+		else if (!strcmp(opt, "-b"))			block = atoi(arg);
+		else if (!strcmp(opt, "-n"))			passes = atoi(arg);
+		else if (!strcmp(opt, "-tol"))			tolerance = atof(arg);
+		else if (!strcmp(opt, "-p") && numKnobs < 16 && strchr(arg, '=')) {
+			knobIndex[numKnobs] = atoi(arg);
+			knobValue[numKnobs++] = atof(strchr(arg, '=') + 1);
+		} else {
+			fprintf(stderr, "CompressorBench: unknown option %s %s\n", opt, arg);
+			return 1;
+		}
+	}
+	long n = (long)(seconds*fs);
+	if (fs < 8000.0 || block < 1 || passes < 1 || n < block) {
+		fprintf(stderr, "CompressorBench: bad rate, length, block size or pass count\n");
+		return 1;
+	}
+
+	// noise, with one channel swelling over 20 dB so the detector sweeps through the threshold
+	float* x[2] = {new float[n], new float[n]};
+	float* y[2] = {new float[n], new float[n]};
+	float* ref[2] = {new float[n], new float[n]};
+	unsigned long long seed = 1;
+	for (long i=0; i<n; i++) {
+		for (int c=0; c<2; c++) {
+			seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+			double u = (double)(seed >> 11)*(1.0/9007199254740992.0) - 0.5;
+			double swell = c ? 1.0 : pow(10.0, sin(2.0*M_PI*0.5*i/fs) - 0.5);
+			x[c][i] = (float)(0.8*u*swell);
+		}
+	}
+
+	double log2Error, exp2Error, libmNs, fastNs;
+	kernelErrors(log2Error, exp2Error);
+	kernelCost(x[0], n, libmNs, fastNs);
+	printf("log2_max_error: %.3g\n", log2Error);
+	printf("log2_max_error_db: %.3g\n", log2Error*kDBPerLog2);
+	printf("exp2_max_relative_error: %.3g\n", exp2Error);
+	printf("round_trip_ns_libm: %.2f\n", libmNs);
+	printf("round_trip_ns_fast: %.2f\n", fastNs);
+
+	// no host: audioMaster is 0, so the rate has to be pushed in by hand
+	Compressor* fast = new Compressor(0);
+	Compressor* slow = new ReferenceCompressor();
+	const float exponents[kNumExponents] = {1.0f, 2.0f, 3.5f};
+	double worst = 0.0;
+	for (int e=0; e<kNumExponents; e++) {
+		float knob = SmartKnob::value2knob(exponents[e], ERateLimits, ERateTaper);
+		Compressor* c[2] = {fast, slow};
+		for (int k=0; k<2; k++) {
+			c[k]->setSampleRate(fs);
+			for (int j=0; j<numKnobs; j++)
+				c[k]->setParameter(knobIndex[j], knobValue[j]);
+			c[k]->setParameter(kParamExponent, knob);
+		}
+		double fastCost = render(fast, x, y, n, block, passes);
+		double slowCost = render(slow, x, ref, n, block, passes);
+		double error = 0.0;
+		for (int ch=0; ch<2; ch++)
+			for (long i=0; i<n; i++)
+				if (fabs(ref[ch][i]) > 1e-6f) {
+					double d = fabs(20.0*log10(fabs(y[ch][i]/ref[ch][i])));
+					if (d > error)
+						error = d;
+				}
+		if (error > worst)
+			worst = error;
+		printf("p%g_gain_max_error_db: %.3g\n", exponents[e], error);
+		printf("p%g_ns_per_frame_libm: %.1f\n", exponents[e], slowCost);
+		printf("p%g_ns_per_frame_fast: %.1f\n", exponents[e], fastCost);
+	}
+	printf("within_tolerance: %s\n", worst <= tolerance ? "yes" : "no");
+
+	delete fast;
+	delete slow;
+	for (int c=0; c<2; c++) {
+		delete[] x[c]; delete[] y[c]; delete[] ref[c];
+	}
+	return worst <= tolerance ? 0 : 1;
+}
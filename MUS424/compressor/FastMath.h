@@ -0,0 +1,139 @@
+//-------------------------------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : FastMath.h
+// Created by   : music424 staff
+// Company      : CCRMA - Stanford
+// Description  : Approximate log2 and exp2 for the per-sample level and gain math of the Compressor.
+//                Both split the float into exponent and mantissa and fit a polynomial to the mantissa
+//                part, so they are branch-free and cost a few multiply-adds. The log2 polynomial is
+//                good to about 4e-7 (the float holding a large result rounds by more, 3e-5 dB at
+//                worst) and exp2 to about 2e-7 relative. CompressorBench.cpp checks both. The x4
+//                versions do four lanes at once with the same arithmetic, so they agree with the
+//                scalar ones bit for bit.
+// Date         : 10/17/26
+//-------------------------------------------------------------------------------------------------------
+
+#ifndef __fastmath__
+#define __fastmath__
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FM_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define FM_NEON 1
+#endif
+
+#define kLog2Floor          -126.0f     // fastLog2 of zero, denormals and anything below 2^-126
+#define kDBPerLog2          6.0205999f  // 20 log10(2): dB per unit of log2 amplitude
+
+
+//-------------------------------------------------------------------------------------------------------
+// log2(x) for x > 0. The mantissa m in [1,2) goes through log2(m) = t q(t), t = m - 1, so log2(1)
+// is exactly 0 and small levels keep their relative accuracy.
+inline float fastLog2(float x)
+{
+	unsigned int bits;
+	memcpy(&bits, &x, sizeof(bits));
+	int e = (int)((bits >> 23) & 255) - 127;
+	bits = (bits & 0x007fffff) | 0x3f800000;
+	float m;
+	memcpy(&m, &bits, sizeof(m));
+	float t = m - 1.0f;
+	float q = 1.4426640452805874f + t*(-0.720515493547274f + t*(0.4731132194138546f
+			+ t*(-0.3246160258322185f + t*(0.1923845348365396f + t*(-0.07815783403505755f
+			+ t*0.015127810234088f)))));
+	return (e == -127) ? kLog2Floor : (float)e + t*q;      // zero or denormal: as quiet as it gets
+}
+
+// 2^x, clamped to the normal float range. x = i + f with f in [0,1); 2^f = 1 + f r(f).
+inline float fastExp2(float x)
+{
+	x = (x < -126.0f) ? -126.0f : (x > 127.0f) ? 127.0f : x;
+	float fl = (float)(int)x;
+	fl = (fl > x) ? fl - 1.0f : fl;                         // floor for negative x
+	float f = x - fl;
+	float r = 0.69315136287511f + f*(0.2401641534205312f + f*(0.05580044733998867f
+			+ f*(0.009016687292380466f + f*0.0018671830006790273f)));
+	unsigned int bits = (unsigned int)((int)fl + 127) << 23;
+	float scale;
+	memcpy(&scale, &bits, sizeof(scale));
+	return scale*(1.0f + f*r);
+}
+
+
+//-------------------------------------------------------------------------------------------------------
+// four lanes of fastLog2() and fastExp2()
+#if defined(FM_SSE2)
+typedef __m128 float4;
+
+inline float4 fastLog2x4(float4 x)
+{
+	__m128i bits = _mm_castps_si128(x);
+	__m128i e = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(255)), _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+	__m128 t = _mm_sub_ps(m, _mm_set1_ps(1.0f));
+	__m128 q = _mm_add_ps(_mm_set1_ps(-0.07815783403505755f), _mm_mul_ps(t, _mm_set1_ps(0.015127810234088f)));
+	q = _mm_add_ps(_mm_set1_ps(0.1923845348365396f), _mm_mul_ps(t, q));
+	q = _mm_add_ps(_mm_set1_ps(-0.3246160258322185f), _mm_mul_ps(t, q));
+	q = _mm_add_ps(_mm_set1_ps(0.4731132194138546f), _mm_mul_ps(t, q));
+	q = _mm_add_ps(_mm_set1_ps(-0.720515493547274f), _mm_mul_ps(t, q));
+	q = _mm_add_ps(_mm_set1_ps(1.4426640452805874f), _mm_mul_ps(t, q));
+	__m128 y = _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(t, q));
+	__m128 quiet = _mm_castsi128_ps(_mm_cmpeq_epi32(e, _mm_set1_epi32(-127)));
+	return _mm_or_ps(_mm_and_ps(quiet, _mm_set1_ps(kLog2Floor)), _mm_andnot_ps(quiet, y));
+}
+
+inline float4 fastExp2x4(float4 x)
+{
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.0f)), _mm_set1_ps(127.0f));
+	__m128 fl = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+	fl = _mm_sub_ps(fl, _mm_and_ps(_mm_cmpgt_ps(fl, x), _mm_set1_ps(1.0f)));
+	__m128 f = _mm_sub_ps(x, fl);
+	__m128 r = _mm_add_ps(_mm_set1_ps(0.009016687292380466f), _mm_mul_ps(f, _mm_set1_ps(0.0018671830006790273f)));
+	r = _mm_add_ps(_mm_set1_ps(0.05580044733998867f), _mm_mul_ps(f, r));
+	r = _mm_add_ps(_mm_set1_ps(0.2401641534205312f), _mm_mul_ps(f, r));
+	r = _mm_add_ps(_mm_set1_ps(0.69315136287511f), _mm_mul_ps(f, r));
+	__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fl), _mm_set1_epi32(127)), 23));
+	return _mm_mul_ps(scale, _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(f, r)));
+}
+
+#elif defined(FM_NEON)
+typedef float32x4_t float4;
+
+inline float4 fastLog2x4(float4 x)
+{
+	uint32x4_t bits = vreinterpretq_u32_f32(x);
+	int32x4_t e = vsubq_s32(vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(bits, 23), vdupq_n_u32(255))), vdupq_n_s32(127));
+	float32x4_t m = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007fffff)), vdupq_n_u32(0x3f800000)));
+	float32x4_t t = vsubq_f32(m, vdupq_n_f32(1.0f));
+	float32x4_t q = vaddq_f32(vdupq_n_f32(-0.07815783403505755f), vmulq_f32(t, vdupq_n_f32(0.015127810234088f)));
+	q = vaddq_f32(vdupq_n_f32(0.1923845348365396f), vmulq_f32(t, q));
+	q = vaddq_f32(vdupq_n_f32(-0.3246160258322185f), vmulq_f32(t, q));
+	q = vaddq_f32(vdupq_n_f32(0.4731132194138546f), vmulq_f32(t, q));
+	q = vaddq_f32(vdupq_n_f32(-0.720515493547274f), vmulq_f32(t, q));
+	q = vaddq_f32(vdupq_n_f32(1.4426640452805874f), vmulq_f32(t, q));
+	float32x4_t y = vaddq_f32(vcvtq_f32_s32(e), vmulq_f32(t, q));
+	return vbslq_f32(vceqq_s32(e, vdupq_n_s32(-127)), vdupq_n_f32(kLog2Floor), y);
+}
+
+inline float4 fastExp2x4(float4 x)
+{
+	x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-126.0f)), vdupq_n_f32(127.0f));
+	float32x4_t fl = vcvtq_f32_s32(vcvtq_s32_f32(x));
+	fl = vbslq_f32(vcgtq_f32(fl, x), vsubq_f32(fl, vdupq_n_f32(1.0f)), fl);
+	float32x4_t f = vsubq_f32(x, fl);
+	float32x4_t r = vaddq_f32(vdupq_n_f32(0.009016687292380466f), vmulq_f32(f, vdupq_n_f32(0.0018671830006790273f)));
+	r = vaddq_f32(vdupq_n_f32(0.05580044733998867f), vmulq_f32(f, r));
+	r = vaddq_f32(vdupq_n_f32(0.2401641534205312f), vmulq_f32(f, r));
+	r = vaddq_f32(vdupq_n_f32(0.69315136287511f), vmulq_f32(f, r));
+	float32x4_t scale = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(fl), vdupq_n_s32(127)), 23));
+	return vmulq_f32(scale, vaddq_f32(vdupq_n_f32(1.0f), vmulq_f32(f, r)));
+}
+#endif
+
+
+#endif
@@ -0,0 +1,224 @@
+//-------------------------------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : Lookahead.h
+// Created by   : music424 staff
+// Company      : CCRMA - Stanford
+// Description  : Brickwall lookahead limiter for the Compressor. The signal is delayed by the longest
+//                lookahead window, so the gain can reach the level a peak needs by the time the peak
+//                comes out.
+//                Peaks are taken between the samples as well as on them, and held for one window with
+//                a sliding maximum; the gain is then a moving average over the same window, which
+//                ramps down ahead of every peak and never rises above what any peak in the window
+//                allows. Peaks are read by a TruePeakDetector, at 4x as a BS.1770 true-peak meter
+//                reads them, so the output stays under the ceiling on such a meter.
+// Date         : 10/17/26
+//-------------------------------------------------------------------------------------------------------
+
+#ifndef __lookahead__
+#define __lookahead__
+
+#include <math.h>
+#include <string.h>
+#include "TruePeak.h"
+
+#define kMaxLookahead       0.010       // seconds
+
+
+//-------------------------------------------------------------------------------------------------------
+//  Largest of the last window values, as a monotonic deque: values that can never be the maximum
+//  again (an older one no larger than a newer one) are dropped as the newer one comes in, so the
+//  front is always the maximum and each value goes in and out once.
+struct SlidingMax {
+
+	float*  value;
+	long*   index;                                          // when each value came in
+	long    capacity, mask;
+	long    head, tail, count;
+
+	SlidingMax() {
+		value = 0;
+		index = 0;
+		capacity = 0;
+		mask = 0;
+		reset();
+	}
+	~SlidingMax() {
+		delete[] value;
+		delete[] index;
+	}
+
+	// room for windows up to window values; only ever grows. Not real-time safe.
+	void reserve(long window) {
+		long s = 1;
+		while (s < window + 1)
+			s <<= 1;
+		if (s > capacity) {
+			delete[] value;
+			delete[] index;
+			value = new float[s];
+			index = new long[s];
+			capacity = s;
+		}
+		mask = capacity - 1;
+		reset();
+	}
+
+	void reset() {
+		head = tail = count = 0;
+	}
+
+	// x in, the largest of the last window (1 to the reserved size) values out
+	float process(float x, long window) {
+		while (tail != head && value[(tail - 1) & mask] <= x)
+			tail--;
+		value[tail & mask] = x;
+		index[tail & mask] = count;
+		tail++;
+		if (index[head & mask] <= count - window)              // at most one falls out per value
+			head++;
+		count++;
+		return value[head & mask];
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------------
+//  The limiter itself. Frame n comes out latency() frames late, scaled so that neither it nor the
+//  interpolated points on either side of it go over the ceiling. Both channels get the same gain.
+//  The audio delay is always that of the longest window; a shorter window reads its peaks from a
+//  tap further down the same delay line, so the window can change without touching the audio.
+struct LookaheadLimiter {
+
+	SlidingMax  peaks;
+	float*  delayLine;                                      // [L R] frames
+	double* held;                                           // the last window gains, for the average
+	long    capacity, mask, wp, delay;
+	long    window, hp;
+	double  ceiling, b0_r, release, sum, invWindow;
+	TruePeakDetector truePeak;
+
+	LookaheadLimiter() {
+		delayLine = 0;
+		held = 0;
+		capacity = 0;
+		mask = 0;
+		delay = 0;
+		window = 0;
+		invWindow = 0.0;
+		ceiling = 1.0;
+		b0_r = 1.0;
+		reset();
+	}
+	~LookaheadLimiter() {
+		delete[] delayLine;
+		delete[] held;
+	}
+
+	// frames from a detector input to the frame its gain is for, for a window (0 is off)
+	static long latencyFor(long window) {
+		return (window > 0) ? window + kTruePeakDelay - 1 : 0;
+	}
+	// frames of delay, whatever the window
+	long latency() const {
+		return delay;
+	}
+
+	// windows up to maxWindow frames, and the delay of the longest; clears the limiter. Not
+	// real-time safe, call while suspended.
+	void reserve(long maxWindow) {
+		long s = 1;
+		while (s < latencyFor(maxWindow) + 1)
+			s <<= 1;
+		if (s > capacity) {
+			delete[] delayLine;
+			delete[] held;
+			delayLine = new float[2*s];
+			held = new double[s];
+			capacity = s;
+		}
+		mask = capacity - 1;
+		delay = latencyFor(maxWindow);
+		peaks.reserve(capacity - kTruePeakDelay);
+		window = min(window, delay - kTruePeakDelay + 1);
+		invWindow = (window > 0) ? 1.0/window : 0.0;
+		reset();
+	}
+
+	// lookahead of w frames, up to the reserved window. Only the detector starts again: it is run
+	// over the audio already in the delay line, so the frames on their way out are still limited.
+	void setWindow(long w) {
+		window = max(0L, min(w, delay - kTruePeakDelay + 1));
+		invWindow = (window > 0) ? 1.0/window : 0.0;
+		resetDetector();
+		if (window <= 0)
+			return;
+		for (long k = delay; k > delay - latencyFor(window); k--) {
+			long p = (wp - k) & mask;
+			detect(delayLine[2*p], delayLine[2*p + 1]);
+		}
+	}
+
+	// release of the gain once the peaks have passed
+	void setRelease(double tau, double fs) {
+		b0_r = 1.0 - exp(-1.0/(tau*fs));
+	}
+
+	void reset() {
+		if (delayLine)
+			memset(delayLine, 0, 2*capacity*sizeof(float));
+		wp = 0;
+		resetDetector();
+	}
+
+	// n frames in place
+	void process(float* yL, float* yR, int n) {
+		long tap = delay - latencyFor(window);              // the detector's input, frames back
+		for (int i = 0; i < n; i++) {
+			delayLine[2*wp] = yL[i];
+			delayLine[2*wp + 1] = yR[i];
+			long rp = (wp - delay) & mask;
+			double gain = 1.0;
+			if (window > 0) {
+				long dp = (wp - tap) & mask;
+				gain = detect(delayLine[2*dp], delayLine[2*dp + 1]);
+			}
+			yL[i] = delayLine[2*rp]*gain;
+			yR[i] = delayLine[2*rp + 1]*gain;
+			wp = (wp + 1) & mask;
+		}
+	}
+
+protected:
+	void resetDetector() {
+		if (held)
+			for (long k = 0; k < capacity; k++)
+				held[k] = 1.0;
+		truePeak.reset();
+		peaks.reset();
+		hp = 0;
+		release = 1.0;
+		sum = (double)window;
+	}
+
+	// one frame into the detector, the gain for the frame latencyFor(window) frames before it out
+	double detect(float xL, float xR) {
+		float peakL, peakR;
+		truePeak.process(xL, xR, peakL, peakR);
+		float level = peaks.process(max(peakL, peakR), window);
+		double g = (level > ceiling) ? ceiling/level : 1.0;
+		release = (g < release) ? g : release + b0_r*(g - release);
+		sum += release - held[hp];
+		held[hp] = release;
+		if (++hp == window) {
+			hp = 0;
+			sum = 0.0;                                      // start again from the exact sum
+			for (long k = 0; k < window; k++)
+				sum += held[k];
+		}
+		return sum*invWindow;
+	}
+};
+
+
+#endif
@@ -0,0 +1,314 @@
+//-------------------------------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : Multiband.h
+// Created by   : music424 staff
+// Company      : CCRMA - Stanford
+// Description  : Band splitting and per-band level detection for the multiband mode of the Compressor.
+//                Both keep their state as arrays with one lane per (channel, band), so a frame of every
+//                band goes through each filter section, and through the detectors, in one pass.
+// Date         : 10/17/26
+//-------------------------------------------------------------------------------------------------------
+
+#ifndef __multiband__
+#define __multiband__
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MB_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MB_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MB_NEON 1
+#endif
+
+#ifndef M_PI
+#define M_PI                3.14159265358979323846
+#endif
+
+#define kMaxBands           5                           // bands of the multiband mode
+#define kBandLanes          12                          // (band, channel) pairs, padded to whole vectors
+#define kMaxXoverSections   (2*(kMaxBands-1))           // biquads per band: two per crossover
+
+
+//-------------------------------------------------------------------------------------------------------
+//  Linkwitz-Riley (4th order) band splitter, run as parallel cascades. Rather than splitting a tree
+//  of crossovers one after the other, each band gets its own chain with one LR4 section per
+//  crossover frequency: highpass for the crossovers below the band, lowpass for the one above it,
+//  and the allpass an LR4 pair sums to for the rest. Every band then has the same allpass phase, so
+//  the bands add back up flat, and all lanes run the same section at the same time.
+struct LRCrossoverBank {
+
+	double  b0[kMaxXoverSections][kBandLanes], b1[kMaxXoverSections][kBandLanes], b2[kMaxXoverSections][kBandLanes];
+	double  a1[kMaxXoverSections][kBandLanes], a2[kMaxXoverSections][kBandLanes];
+	double  z1[kMaxXoverSections][kBandLanes], z2[kMaxXoverSections][kBandLanes];
+	int     numBands, numSections, numLanes;
+
+	LRCrossoverBank() {
+		numBands = 1;
+		numSections = 0;
+		numLanes = 0;
+		memset(b0, 0, sizeof(b0)); memset(b1, 0, sizeof(b1)); memset(b2, 0, sizeof(b2));
+		memset(a1, 0, sizeof(a1)); memset(a2, 0, sizeof(a2));
+		reset();
+	}
+
+	// bands bands (2 to kMaxBands) split at the bands-1 ascending frequencies in freqs, Hz. The
+	// filter state is kept, so moving a crossover doesn't click; reset() if the band count changed.
+	void design(int bands, const double* freqs, double fs) {
+		numBands = (bands < 2) ? 2 : (bands > kMaxBands) ? kMaxBands : bands;
+		numSections = 2*(numBands-1);
+		numLanes = (2*numBands + 3) & ~3;                      // whole AVX vectors
+		memset(b0, 0, sizeof(b0)); memset(b1, 0, sizeof(b1)); memset(b2, 0, sizeof(b2));
+		memset(a1, 0, sizeof(a1)); memset(a2, 0, sizeof(a2));     // unused lanes stay silent
+		for (int k=0; k<numBands-1; k++) {
+			double lp[5], hp[5], ap[5], id[5] = {1.0, 0.0, 0.0, 0.0, 0.0};
+			butterworth(lp, hp, ap, freqs[k], fs);
+			for (int b=0; b<numBands; b++) {
+				const double *first = ap, *second = id;
+				if (k < b)
+					first = second = hp;                           // band lies above this crossover
+				else if (k == b)
+					first = second = lp;                           // this crossover is its upper edge
+				for (int c=0; c<2; c++) {
+					setSection(2*k, 2*b + c, first);
+					setSection(2*k+1, 2*b + c, second);
+				}
+			}
+		}
+	}
+
+	void reset() {
+		memset(z1, 0, sizeof(z1));
+		memset(z2, 0, sizeof(z2));
+	}
+
+	// one frame: xL, xR in, every band of both channels out, y[2*band + channel]
+	void process(double xL, double xR, double* y) {
+		int i;
+		for (i=0; i<kBandLanes; i+=2) {
+			y[i] = xL;
+			y[i+1] = xR;
+		}
+		for (int s=0; s<numSections; s++) {
+			i = 0;
+#if defined(MB_AVX)
+			for (; i<numLanes; i+=4) {
+				__m256d x = _mm256_loadu_pd(y+i);
+				__m256d out = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(b0[s]+i), x), _mm256_loadu_pd(z1[s]+i));
+				_mm256_storeu_pd(z1[s]+i, _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(_mm256_loadu_pd(b1[s]+i), x),
+								 _mm256_mul_pd(_mm256_loadu_pd(a1[s]+i), out)), _mm256_loadu_pd(z2[s]+i)));
+				_mm256_storeu_pd(z2[s]+i, _mm256_sub_pd(_mm256_mul_pd(_mm256_loadu_pd(b2[s]+i), x),
+								 _mm256_mul_pd(_mm256_loadu_pd(a2[s]+i), out)));
+				_mm256_storeu_pd(y+i, out);
+			}
+#elif defined(MB_SSE2)
+			for (; i<numLanes; i+=2) {
+				__m128d x = _mm_loadu_pd(y+i);
+				__m128d out = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(b0[s]+i), x), _mm_loadu_pd(z1[s]+i));
+				_mm_storeu_pd(z1[s]+i, _mm_add_pd(_mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(b1[s]+i), x),
+							  _mm_mul_pd(_mm_loadu_pd(a1[s]+i), out)), _mm_loadu_pd(z2[s]+i)));
+				_mm_storeu_pd(z2[s]+i, _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(b2[s]+i), x),
+							  _mm_mul_pd(_mm_loadu_pd(a2[s]+i), out)));
+				_mm_storeu_pd(y+i, out);
+			}
+#elif defined(MB_NEON)
+			for (; i<numLanes; i+=2) {
+				float64x2_t x = vld1q_f64(y+i);
+				float64x2_t out = vaddq_f64(vmulq_f64(vld1q_f64(b0[s]+i), x), vld1q_f64(z1[s]+i));
+				vst1q_f64(z1[s]+i, vaddq_f64(vsubq_f64(vmulq_f64(vld1q_f64(b1[s]+i), x),
+						  vmulq_f64(vld1q_f64(a1[s]+i), out)), vld1q_f64(z2[s]+i)));
+				vst1q_f64(z2[s]+i, vsubq_f64(vmulq_f64(vld1q_f64(b2[s]+i), x),
+						  vmulq_f64(vld1q_f64(a2[s]+i), out)));
+				vst1q_f64(y+i, out);
+			}
+#endif
+			for (; i<numLanes; i++) {
+				double x = y[i];
+				double out = b0[s][i]*x + z1[s][i];                // transposed direct form II
+				z1[s][i] = b1[s][i]*x - a1[s][i]*out + z2[s][i];
+				z2[s][i] = b2[s][i]*x - a2[s][i]*out;
+				y[i] = out;
+			}
+		}
+	}
+
+protected:
+	void setSection(int s, int lane, const double* c) {
+		b0[s][lane] = c[0]; b1[s][lane] = c[1]; b2[s][lane] = c[2]; a1[s][lane] = c[3]; a2[s][lane] = c[4];
+	}
+
+	// Butterworth lowpass and highpass (Q = 1/sqrt(2)) at fc, and the allpass their squares sum to,
+	// all [b0 b1 b2 a1 a2] through the same prewarped bilinear transform
+	static void butterworth(double* lp, double* hp, double* ap, double fc, double fs) {
+		double k = tan(M_PI*fc/fs), k2 = k*k, r = sqrt(2.0)*k;
+		double norm = 1.0/(1.0 + r + k2);
+		double a1 = 2.0*(k2 - 1.0)*norm, a2 = (1.0 - r + k2)*norm;
+		lp[0] = k2*norm; lp[1] = 2.0*k2*norm; lp[2] = k2*norm; lp[3] = a1; lp[4] = a2;
+		hp[0] = norm; hp[1] = -2.0*norm; hp[2] = norm; hp[3] = a1; hp[4] = a2;
+		ap[0] = a2; ap[1] = a1; ap[2] = 1.0; ap[3] = a1; ap[4] = a2;
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------------
+//  The full-band detector law for every band at once, linked across the two channels the way the
+//  full-band detector is: the mean of |x|^p with the release time constant (PeakDetector::
+//  process_RMS_pnorm()), or the program-dependent release of PeakDetector::process_adaptive(). The
+//  levels stay as mean |x|^p; the gain computer takes the 1/p root. Attack and release are min/max
+//  terms rather than branches, so the lanes stay in step.
+struct PeakDetectorBank {
+
+	double  b0_a, b0_r, b0_rf, b0_m, crestLow, crestSpan;
+	float   p;
+	int     power;                                              // 1 or 2 when p is, 0 for any other p
+	bool    adaptive;                                           // program-dependent release
+	double  levelEstimate[kBandLanes/2];
+	double  fastEstimate[kBandLanes/2], slowEstimate[kBandLanes/2], meanEstimate[kBandLanes/2];
+	double  in[kBandLanes/2];                                   // this frame's detector inputs, |x|^p
+
+	PeakDetectorBank() {
+		b0_a = b0_r = b0_rf = b0_m = 1.0;                       // default to pass-through
+		crestLow = crestSpan = 1.0;
+		p = 1.0f;
+		power = 1;
+		adaptive = false;
+		memset(in, 0, sizeof(in));
+		reset();
+	}
+
+	// same time constants, exponent and release law as the full-band detector
+	void setFrom(const PeakDetector& pd, bool adaptiveRelease, int detectorPower, float exponent) {
+		b0_a = pd.b0_a;
+		b0_r = pd.b0_r;
+		b0_rf = pd.b0_rf;
+		b0_m = pd.b0_m;
+		crestLow = pd.crestLow;
+		crestSpan = pd.crestSpan;
+		adaptive = adaptiveRelease;
+		power = detectorPower;
+		p = exponent;
+	}
+
+	void reset() {
+		memset(levelEstimate, 0, sizeof(levelEstimate));
+		memset(fastEstimate, 0, sizeof(fastEstimate));
+		memset(slowEstimate, 0, sizeof(slowEstimate));
+		memset(meanEstimate, 0, sizeof(meanEstimate));
+	}
+
+	// y from LRCrossoverBank::process(); mean |x|^p of band b ends up in levelEstimate[b]
+	void process(const double* y) {
+		int i;
+		for (i=0; i<kBandLanes/2; i++) {
+			float x = (float)(0.5*(fabs(y[2*i]) + fabs(y[2*i+1])));
+			in[i] = (power == 1) ? x : (power == 2) ? x*x : fastExp2(p*fastLog2(x));
+		}
+		if (adaptive)
+			processAdaptive();
+		else
+			processRelease();
+	}
+
+protected:
+	void processRelease() {
+		int i = 0;
+#if defined(MB_AVX)
+		__m256d br = _mm256_set1_pd(b0_r);
+		for (; i+4<=kBandLanes/2; i+=4) {
+			__m256d lev = _mm256_loadu_pd(levelEstimate+i);
+			_mm256_storeu_pd(levelEstimate+i, _mm256_add_pd(lev, _mm256_mul_pd(br, _mm256_sub_pd(_mm256_loadu_pd(in+i), lev))));
+		}
+#elif defined(MB_SSE2)
+		__m128d br = _mm_set1_pd(b0_r);
+		for (; i+2<=kBandLanes/2; i+=2) {
+			__m128d lev = _mm_loadu_pd(levelEstimate+i);
+			_mm_storeu_pd(levelEstimate+i, _mm_add_pd(lev, _mm_mul_pd(br, _mm_sub_pd(_mm_loadu_pd(in+i), lev))));
+		}
+#elif defined(MB_NEON)
+		float64x2_t br = vdupq_n_f64(b0_r);
+		for (; i+2<=kBandLanes/2; i+=2) {
+			float64x2_t lev = vld1q_f64(levelEstimate+i);
+			vst1q_f64(levelEstimate+i, vaddq_f64(lev, vmulq_f64(br, vsubq_f64(vld1q_f64(in+i), lev))));
+		}
+#endif
+		for (; i<kBandLanes/2; i++)
+			levelEstimate[i] += b0_r*(in[i] - levelEstimate[i]);
+	}
+
+	void processAdaptive() {
+		int i = 0;
+#if defined(MB_AVX)
+		__m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0), ba = _mm256_set1_pd(b0_a);
+		for (; i+4<=kBandLanes/2; i+=4) {
+			__m256d x = _mm256_loadu_pd(in+i);
+			__m256d f = _mm256_loadu_pd(fastEstimate+i), s = _mm256_loadu_pd(slowEstimate+i), m = _mm256_loadu_pd(meanEstimate+i);
+			__m256d d = _mm256_sub_pd(x, f);
+			f = _mm256_add_pd(f, _mm256_add_pd(_mm256_mul_pd(ba, _mm256_max_pd(d, zero)), _mm256_mul_pd(_mm256_set1_pd(b0_rf), _mm256_min_pd(d, zero))));
+			d = _mm256_sub_pd(x, s);
+			s = _mm256_add_pd(s, _mm256_add_pd(_mm256_mul_pd(ba, _mm256_max_pd(d, zero)), _mm256_mul_pd(_mm256_set1_pd(b0_r), _mm256_min_pd(d, zero))));
+			m = _mm256_add_pd(m, _mm256_mul_pd(_mm256_set1_pd(b0_m), _mm256_sub_pd(x, m)));
+			__m256d w = _mm256_div_pd(_mm256_sub_pd(s, _mm256_mul_pd(_mm256_set1_pd(crestLow), m)),
+									  _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(crestSpan), m), _mm256_set1_pd(1e-30)));
+			w = _mm256_min_pd(_mm256_max_pd(w, zero), one);
+			_mm256_storeu_pd(levelEstimate+i, _mm256_add_pd(s, _mm256_mul_pd(w, _mm256_sub_pd(f, s))));
+			_mm256_storeu_pd(fastEstimate+i, f);
+			_mm256_storeu_pd(slowEstimate+i, s);
+			_mm256_storeu_pd(meanEstimate+i, m);
+		}
+#elif defined(MB_SSE2)
+		__m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0), ba = _mm_set1_pd(b0_a);
+		for (; i+2<=kBandLanes/2; i+=2) {
+			__m128d x = _mm_loadu_pd(in+i);
+			__m128d f = _mm_loadu_pd(fastEstimate+i), s = _mm_loadu_pd(slowEstimate+i), m = _mm_loadu_pd(meanEstimate+i);
+			__m128d d = _mm_sub_pd(x, f);
+			f = _mm_add_pd(f, _mm_add_pd(_mm_mul_pd(ba, _mm_max_pd(d, zero)), _mm_mul_pd(_mm_set1_pd(b0_rf), _mm_min_pd(d, zero))));
+			d = _mm_sub_pd(x, s);
+			s = _mm_add_pd(s, _mm_add_pd(_mm_mul_pd(ba, _mm_max_pd(d, zero)), _mm_mul_pd(_mm_set1_pd(b0_r), _mm_min_pd(d, zero))));
+			m = _mm_add_pd(m, _mm_mul_pd(_mm_set1_pd(b0_m), _mm_sub_pd(x, m)));
+			__m128d w = _mm_div_pd(_mm_sub_pd(s, _mm_mul_pd(_mm_set1_pd(crestLow), m)),
+								   _mm_add_pd(_mm_mul_pd(_mm_set1_pd(crestSpan), m), _mm_set1_pd(1e-30)));
+			w = _mm_min_pd(_mm_max_pd(w, zero), one);
+			_mm_storeu_pd(levelEstimate+i, _mm_add_pd(s, _mm_mul_pd(w, _mm_sub_pd(f, s))));
+			_mm_storeu_pd(fastEstimate+i, f);
+			_mm_storeu_pd(slowEstimate+i, s);
+			_mm_storeu_pd(meanEstimate+i, m);
+		}
+#elif defined(MB_NEON)
+		float64x2_t zero = vdupq_n_f64(0.0), one = vdupq_n_f64(1.0), ba = vdupq_n_f64(b0_a);
+		for (; i+2<=kBandLanes/2; i+=2) {
+			float64x2_t x = vld1q_f64(in+i);
+			float64x2_t f = vld1q_f64(fastEstimate+i), s = vld1q_f64(slowEstimate+i), m = vld1q_f64(meanEstimate+i);
+			float64x2_t d = vsubq_f64(x, f);
+			f = vaddq_f64(f, vaddq_f64(vmulq_f64(ba, vmaxq_f64(d, zero)), vmulq_f64(vdupq_n_f64(b0_rf), vminq_f64(d, zero))));
+			d = vsubq_f64(x, s);
+			s = vaddq_f64(s, vaddq_f64(vmulq_f64(ba, vmaxq_f64(d, zero)), vmulq_f64(vdupq_n_f64(b0_r), vminq_f64(d, zero))));
+			m = vaddq_f64(m, vmulq_f64(vdupq_n_f64(b0_m), vsubq_f64(x, m)));
+			float64x2_t w = vdivq_f64(vsubq_f64(s, vmulq_f64(vdupq_n_f64(crestLow), m)),
+									  vaddq_f64(vmulq_f64(vdupq_n_f64(crestSpan), m), vdupq_n_f64(1e-30)));
+			w = vminq_f64(vmaxq_f64(w, zero), one);
+			vst1q_f64(levelEstimate+i, vaddq_f64(s, vmulq_f64(w, vsubq_f64(f, s))));
+			vst1q_f64(fastEstimate+i, f);
+			vst1q_f64(slowEstimate+i, s);
+			vst1q_f64(meanEstimate+i, m);
+		}
+#endif
+		for (; i<kBandLanes/2; i++) {
+			double d = in[i] - fastEstimate[i];
+			fastEstimate[i] += b0_a*max(d, 0.0) + b0_rf*min(d, 0.0);
+			d = in[i] - slowEstimate[i];
+			slowEstimate[i] += b0_a*max(d, 0.0) + b0_r*min(d, 0.0);
+			meanEstimate[i] += b0_m*(in[i] - meanEstimate[i]);
+			double w = (slowEstimate[i] - crestLow*meanEstimate[i])/(crestSpan*meanEstimate[i] + 1e-30);
+			w = min(max(w, 0.0), 1.0);
+			levelEstimate[i] = slowEstimate[i] + w*(fastEstimate[i] - slowEstimate[i]);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,140 @@
+//-------------------------------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : TruePeak.h
+// Created by   : music424 staff
+// Company      : CCRMA - Stanford
+// Description  : 4x oversampled peak reading for two channels, in the manner of an ITU-R BS.1770
+//                true-peak meter. Nothing is zero-stuffed: each frame the last kTPTaps samples go
+//                through the three fractional-delay phases of the interpolator at once, one phase
+//                per SIMD lane, with the sample itself in the fourth lane.
+// Date         : 10/17/26
+//-------------------------------------------------------------------------------------------------------
+
+#ifndef __truepeak__
+#define __truepeak__
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TP_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TP_NEON 1
+#endif
+
+#ifndef M_PI
+#define M_PI                3.14159265358979323846
+#endif
+
+#define kTPTaps             16          // taps per phase of the interpolator
+#define kTPPhases           4           // 4x: three points between each pair of samples
+#define kTPKaiserBeta       5.0
+#define kTruePeakDelay      (kTPTaps/2) // frames a reading lags the input
+
+
+//-------------------------------------------------------------------------------------------------------
+//  Each frame in, the largest magnitude per channel around the sample kTruePeakDelay frames back: the
+//  sample itself and the three interpolated points on either side of it.
+struct TruePeakDetector {
+
+	float   coef[kTPTaps][4];                               // per tap: phases 1/4, 1/2, 3/4, then 0
+	float   history[2][2*kTPTaps];                          // each channel twice over, see process()
+	int     pos;
+	float   after[2];                                       // the last frame's sample and points after it
+
+	TruePeakDetector() {
+		design();
+		reset();
+	}
+
+	void reset() {
+		memset(history, 0, sizeof(history));
+		pos = 0;
+		after[0] = after[1] = 0.0f;
+	}
+
+	void process(float xL, float xR, float& peakL, float& peakR) {
+		// written twice, so the last kTPTaps samples always sit in order at history + pos
+		history[0][pos] = history[0][pos + kTPTaps] = xL;
+		history[1][pos] = history[1][pos + kTPTaps] = xR;
+		pos = (pos + 1 == kTPTaps) ? 0 : pos + 1;
+		const float* hL = history[0] + pos;
+		const float* hR = history[1] + pos;
+#if defined(TP_SSE2)
+		__m128 accL = _mm_setzero_ps(), accR = _mm_setzero_ps();
+		for (int t = 0; t < kTPTaps; t++) {
+			__m128 c = _mm_loadu_ps(coef[t]);
+			accL = _mm_add_ps(accL, _mm_mul_ps(c, _mm_set1_ps(hL[t])));
+			accR = _mm_add_ps(accR, _mm_mul_ps(c, _mm_set1_ps(hR[t])));
+		}
+		__m128 sign = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		accL = _mm_and_ps(accL, sign);
+		accR = _mm_and_ps(accR, sign);
+		__m128 m = _mm_max_ps(_mm_unpacklo_ps(accL, accR), _mm_unpackhi_ps(accL, accR));     // L R L R
+		m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+		float aL = _mm_cvtss_f32(m);
+		float aR = _mm_cvtss_f32(_mm_shuffle_ps(m, m, 1));
+#elif defined(TP_NEON)
+		float32x4_t accL = vdupq_n_f32(0.0f), accR = vdupq_n_f32(0.0f);
+		for (int t = 0; t < kTPTaps; t++) {
+			float32x4_t c = vld1q_f32(coef[t]);
+			accL = vaddq_f32(accL, vmulq_f32(c, vdupq_n_f32(hL[t])));
+			accR = vaddq_f32(accR, vmulq_f32(c, vdupq_n_f32(hR[t])));
+		}
+		float aL = vmaxvq_f32(vabsq_f32(accL));
+		float aR = vmaxvq_f32(vabsq_f32(accR));
+#else
+		float aL = 0.0f, aR = 0.0f;
+		for (int k = 0; k < 4; k++) {
+			float vL = 0.0f, vR = 0.0f;
+			for (int t = 0; t < kTPTaps; t++) {
+				vL += coef[t][k]*hL[t];
+				vR += coef[t][k]*hR[t];
+			}
+			aL = (fabsf(vL) > aL) ? fabsf(vL) : aL;
+			aR = (fabsf(vR) > aR) ? fabsf(vR) : aR;
+		}
+#endif
+		// the points before the sample are the ones after the sample before it
+		peakL = (after[0] > aL) ? after[0] : aL;
+		peakR = (after[1] > aR) ? after[1] : aR;
+		after[0] = aL;
+		after[1] = aR;
+	}
+
+protected:
+	// Kaiser-windowed sinc at the fractions 1/4, 1/2 and 3/4 of the way from the centre tap,
+	// kTPTaps/2 - 1, to the next, each phase scaled to unity gain at DC. Good to 0.5% up to 0.4 fs.
+	void design() {
+		memset(coef, 0, sizeof(coef));
+		for (int k = 0; k < kTPPhases-1; k++) {
+			double total = 0.0, h[kTPTaps];
+			for (int t = 0; t < kTPTaps; t++) {
+				double d = t - (kTPTaps/2 - 1) - (k + 1.0)/kTPPhases;
+				double sinc = (d == 0.0) ? 1.0 : sin(M_PI*d)/(M_PI*d);
+				double r = d/(kTPTaps/2);
+				h[t] = sinc*besselI0(kTPKaiserBeta*sqrt((r*r < 1.0) ? 1.0 - r*r : 0.0))/besselI0(kTPKaiserBeta);
+				total += h[t];
+			}
+			for (int t = 0; t < kTPTaps; t++)
+				coef[t][k] = (float)(h[t]/total);
+		}
+		coef[kTPTaps/2 - 1][3] = 1.0f;                      // the sample itself
+	}
+
+	// modified Bessel function of the first kind, order 0, from its series
+	static double besselI0(double x) {
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; k++) {
+			term *= (0.5*x/k)*(0.5*x/k);
+			sum += term;
+		}
+		return sum;
+	}
+};
+
+
+#endif
@@ -0,0 +1,460 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : ConvReverb.cpp
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  :
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#include "ConvReverb.h"
+#include <math.h>
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+AudioEffect* createEffectInstance (audioMasterCallback audioMaster)
+{
+	return new ConvReverb (audioMaster);
+}
+
+//------------------------------------------------------------------------------
+ConvReverb::ConvReverb (audioMasterCallback audioMaster)
+: AudioEffectX (audioMaster, 1, kNumParams)	// 1 program
+{
+	setNumInputs (kNumInputs);		// stereo in
+	setNumOutputs (kNumOutputs);		// stereo out
+	setUniqueID ('CnvR');	// identify
+	canProcessReplacing ();	// supports replacing output
+	setInitialDelay (0);	// the head of the IR runs as a direct FIR, no latency
+
+	vst_strncpy (programName, "Default", kVstMaxProgNameLen);	// default program name
+
+	// internal state var declaration and initialization
+
+	fs = getSampleRate();
+
+	WetDryKnob = 0.2;		// output (wet/dry) mix
+
+    ParametricFcValue = 5000.0;
+    ParametricFcKnob = SmartKnob::value2knob(ParametricFcValue, ParametricFcLimits, ParametricFcTaper);
+    ParametricGammaValue = 0.0;
+    ParametricGammaKnob = SmartKnob::value2knob(ParametricGammaValue, ParametricGammaLimits, ParametricGammaTaper);
+    ParametricQValue = 1;
+    ParametricQKnob = SmartKnob::value2knob(ParametricQValue, ParametricQLimits, ParametricQTaper);
+
+    designParametric(parametric_coefs, ParametricFcValue, ParametricGammaValue, ParametricQValue);
+	parametric[0].setCoefs(parametric_coefs);
+	parametric[1].setCoefs(parametric_coefs);
+
+	// impulse response: $CONVREVERB_IR, else kDefaultIRPath, else a built-in one
+	const char* path = getenv("CONVREVERB_IR");
+	if (!loadImpulse(path ? path : kDefaultIRPath))
+		makeDefaultImpulse();
+}
+
+//------------------------------------------------------------------------------
+ConvReverb::~ConvReverb ()
+{
+	// nothing to do here
+}
+
+//------------------------------------------------------------------------------
+bool ConvReverb::loadImpulse(const char* path)
+{
+	if (!ir.Load(path))
+		return false;
+	prepareImpulse();
+	return true;
+}
+
+//------------------------------------------------------------------------------
+void ConvReverb::makeDefaultImpulse()
+{
+	long frames = (long)(kDefaultIRLength*fs);
+	double decay = log(0.001)/(1.5*fs);				// T60 of 1.5 s
+	unsigned int seed = 22222;
+	ir.Allocate(2, frames, fs);
+	for (long i=0; i<frames; i++)
+		for (int c=0; c<2; c++) {
+			seed = seed*1664525u + 1013904223u;			// independent noise on each side
+			ir.data[c][i] = ((int)(seed >> 8) / 8388608.0 - 1.0)*exp(decay*i);
+		}
+	prepareImpulse();
+}
+
+//------------------------------------------------------------------------------
+// modified Bessel function of the first kind, order 0, from its series
+static double besselI0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; k++) {
+		term *= (0.5*x/k)*(0.5*x/k);
+		sum += term;
+	}
+	return sum;
+}
+
+//------------------------------------------------------------------------------
+// Bring the loaded IR to the current sample rate and scale it to unit energy
+// on the louder side, so the wet level doesn't depend on how the IR was
+// recorded. The resampler is a Kaiser-windowed sinc cut off below the lower
+// of the two Nyquists, so a 96 kHz IR loaded at 48 kHz doesn't fold its top
+// octave back into the tail. The kernel is tabulated and read with linear
+// interpolation, in units of the lower rate's samples.
+void ConvReverb::prepareImpulse()
+{
+	if (ir.frames == 0 || ir.sampleRate <= 0.0)
+		return;
+	double step = ir.sampleRate/fs;						// IR samples per output sample
+	long frames = (long)floor((ir.frames-1)/step) + 1;
+	double scale = (step > 1.0) ? 1.0/step : 1.0;		// lower rate over the IR's
+	double width = kResampleZeros/scale;				// kernel half-width, IR samples
+	long tableLen = kResampleZeros*kResampleTable;
+	double* kernel = new double[tableLen + 2];
+	for (long k=0; k<=tableLen; k++) {
+		double x = (double)k/kResampleTable, r = x/kResampleZeros;
+		double sinc = (k == 0) ? 1.0 : sin(M_PI*kResampleCutoff*x)/(M_PI*kResampleCutoff*x);
+		kernel[k] = kResampleCutoff*scale*sinc*besselI0(kResampleBeta*sqrt(1.0 - r*r))/besselI0(kResampleBeta);
+	}
+	kernel[tableLen + 1] = 0.0;
+
+	double* h[2];
+	double energy = 0.0;
+	int c;
+	for (c=0; c<ir.channels; c++) {
+		double e = 0.0;
+		h[c] = new double[frames];
+		for (long i=0; i<frames; i++) {
+			if (step == 1.0)
+				h[c][i] = ir.data[c][i];					// same rate: as it is
+			else {
+				double pos = i*step, sum = 0.0;
+				long j0 = (long)ceil(pos - width), j1 = (long)floor(pos + width);
+				j0 = (j0 < 0) ? 0 : j0;
+				j1 = (j1 > ir.frames-1) ? ir.frames-1 : j1;
+				for (long j=j0; j<=j1; j++) {
+					double x = fabs(pos - j)*scale*kResampleTable;
+					long k = (long)x;
+					if (k >= tableLen)
+						continue;
+					sum += ir.data[c][j]*(kernel[k] + (x - k)*(kernel[k+1] - kernel[k]));
+				}
+				h[c][i] = sum;
+			}
+			e += h[c][i]*h[c][i];
+		}
+		if (e > energy) energy = e;
+	}
+	delete[] kernel;
+	double norm = (energy > 0.0) ? 1.0/sqrt(energy) : 1.0;
+	for (c=0; c<ir.channels; c++)
+		for (long i=0; i<frames; i++)
+			h[c][i] *= norm;
+
+	conv.SetImpulse(h, ir.channels, frames);
+	for (c=0; c<ir.channels; c++)
+		delete[] h[c];
+}
+
+//------------------------------------------------------------------------------
+void ConvReverb::setSampleRate (float sampleRate)
+{
+	AudioEffectX::setSampleRate(sampleRate);
+	if (fs == sampleRate)
+		return;
+	fs = sampleRate;
+
+	// always called while suspended, so it is safe to rebuild the partitions
+	prepareImpulse();
+	designParametric(parametric_coefs, ParametricFcValue, ParametricGammaValue, ParametricQValue);
+	parametric[0].setCoefs(parametric_coefs);
+	parametric[1].setCoefs(parametric_coefs);
+}
+
+//------------------------------------------------------------------------------
+void ConvReverb::resume ()
+{
+	if (fs != getSampleRate())							// some hosts only update the rate before resuming
+		setSampleRate(getSampleRate());
+	conv.Reset();										// start from silence
+	parametric[0].reset();
+	parametric[1].reset();
+}
+
+//------------------------------------------------------------------------------
+// the wet signal ends one IR length after the input stops (the parametric
+// section rings for a negligible part of that); 1 means no tail, as opposed
+// to 0 for the host's default
+VstInt32 ConvReverb::getGetTailSize ()
+{
+	return (conv.GetLength() > 0) ? (VstInt32)conv.GetLength() : 1;
+}
+
+//------------------------------------------------------------------------------
+void ConvReverb::setProgramName (char* name)
+{
+	vst_strncpy (programName, name, kVstMaxProgNameLen);
+}
+
+//------------------------------------------------------------------------------
+void ConvReverb::getProgramName (char* name)
+{
+	vst_strncpy (name, programName, kVstMaxProgNameLen);
+}
+
+//------------------------------------------------------------------------------
+void ConvReverb::setParameter (VstInt32 index, float value)
+{
+	switch (index)
+	{
+        case kParamWetDry:
+            WetDryKnob = value;
+            break;
+        case kParamQ:
+            ParametricQKnob = value;
+            ParametricQValue = SmartKnob::knob2value(ParametricQKnob, ParametricQLimits, ParametricQTaper);
+            designParametric(parametric_coefs, ParametricFcValue, ParametricGammaValue, ParametricQValue);
+            parametric[0].setCoefs(parametric_coefs);
+            parametric[1].setCoefs(parametric_coefs);
+            break;
+        case kParamGamma:
+            ParametricGammaKnob = value;
+            ParametricGammaValue = SmartKnob::knob2value(ParametricGammaKnob, ParametricGammaLimits, ParametricGammaTaper);
+            designParametric(parametric_coefs, ParametricFcValue, ParametricGammaValue, ParametricQValue);
+            parametric[0].setCoefs(parametric_coefs);
+            parametric[1].setCoefs(parametric_coefs);
+            break;
+        case kParamFc:
+            ParametricFcKnob = value;
+            ParametricFcValue = SmartKnob::knob2value(ParametricFcKnob, ParametricFcLimits, ParametricFcTaper);
+            designParametric(parametric_coefs, ParametricFcValue, ParametricGammaValue, ParametricQValue);
+            parametric[0].setCoefs(parametric_coefs);
+            parametric[1].setCoefs(parametric_coefs);
+            break;
+
+        default :
+            break;
+	};
+}
+
+//------------------------------------------------------------------------------
+float ConvReverb::getParameter (VstInt32 index)
+{
+	switch (index)
+	{
+        case kParamWetDry:
+            return WetDryKnob;
+            break;
+        case kParamQ:
+            return ParametricQKnob;
+            break;
+        case kParamGamma:
+            return ParametricGammaKnob;
+            break;
+        case kParamFc:
+            return ParametricFcKnob;
+            break;
+        default :
+            return 0.0;
+	};
+}
+
+//------------------------------------------------------------------------------
+void ConvReverb::getParameterName (VstInt32 index, char* label)
+{
+	switch (index)
+	{
+        case kParamWetDry:
+            vst_strncpy(label, " Wet/Dry ", kVstMaxParamStrLen);
+            break;
+        case kParamQ:
+            vst_strncpy(label, " Q ", kVstMaxParamStrLen);
+            break;
+        case kParamGamma:
+            vst_strncpy(label, " Gain ", kVstMaxParamStrLen);
+            break;
+        case kParamFc:
+            vst_strncpy(label, " Fc ", kVstMaxParamStrLen);
+            break;
+        default :
+            *label = '\0';
+            break;
+	};
+}
+
+//------------------------------------------------------------------------------
+void ConvReverb::getParameterDisplay (VstInt32 index, char* text)
+{
+	switch (index)
+	{
+        case kParamWetDry:
+            float2string(100.0*WetDryKnob, text, kVstMaxParamStrLen);
+            break;
+        case kParamQ:
+            float2string(ParametricQValue, text, kVstMaxParamStrLen);
+            break;
+        case kParamGamma:
+            float2string(ParametricGammaValue, text, kVstMaxParamStrLen);
+            break;
+        case kParamFc:
+            float2string(ParametricFcValue, text, kVstMaxParamStrLen);
+            break;
+        default :
+            *text = '\0';
+            break;
+	};
+}
+
+//------------------------------------------------------------------------------
+void ConvReverb::getParameterLabel (VstInt32 index, char* label)
+{
+	switch (index)
+	{
+        case kParamWetDry:
+            vst_strncpy(label, " % ", kVstMaxParamStrLen);
+            break;
+        case kParamQ:
+            vst_strncpy(label, " ", kVstMaxParamStrLen);
+            break;
+        case kParamGamma:
+            vst_strncpy(label, " dB ", kVstMaxParamStrLen);
+            break;
+        case kParamFc:
+            vst_strncpy(label, " Hz ", kVstMaxParamStrLen);
+            break;
+        default :
+            *label = '\0';
+            break;
+	};
+}
+
+//------------------------------------------------------------------------
+bool ConvReverb::getEffectName (char* name)
+{
+	vst_strncpy (name, "ConvReverb", kVstMaxEffectNameLen);
+	return true;
+}
+
+//------------------------------------------------------------------------
+bool ConvReverb::getProductString (char* text)
+{
+	vst_strncpy (text, "ConvReverb", kVstMaxProductStrLen);
+	return true;
+}
+
+//------------------------------------------------------------------------
+bool ConvReverb::getVendorString (char* text)
+{
+	vst_strncpy (text, "Stanford/CCRMA MUS424", kVstMaxVendorStrLen);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+VstInt32 ConvReverb::getVendorVersion ()
+{
+	return 1000;
+}
+
+
+//------------------------------------------------------------------------------
+void ConvReverb::processReplacing (float** inputs, float** outputs, VstInt32 sampleFrames)
+{
+	float*	in0		= inputs[0];
+	float*  in1     = inputs[1];
+	float*	out0	= outputs[0];
+	float*  out1    = outputs[1];
+
+	while (sampleFrames > 0)
+	{
+		int block = (sampleFrames < kMaxBlock) ? sampleFrames : kMaxBlock;
+		int i;
+
+		for (i = 0; i < block; i++)
+		{
+			dry[0][i]=*in0++;
+			dry[1][i]=*in1++;
+		}
+
+		conv.Process(dry[0], dry[1], wet[0], wet[1], block);		// convolve the whole block
+
+		for (i = 0; i < block; i++)
+		{
+            // parametric section on the wet signal
+            parametric[0].process(wet[0][i], wet[0][i]);
+            parametric[1].process(wet[1][i], wet[1][i]);
+
+			*out0++ = wet[0][i]*WetDryKnob + dry[0][i]*(1.0-WetDryKnob);	// compute wet/dry output
+			*out1++ = wet[1][i]*WetDryKnob + dry[1][i]*(1.0-WetDryKnob);
+		}
+		sampleFrames -= block;
+	}
+}
+
+
+//------------------------------------------------------------------------------
+void ConvReverb::bilinearTransform(double acoefs[], double dcoefs[])
+{
+	double b0, b1, b2, a0, a1, a2;		    //storage for continuous-time filter coefs
+	double bz0, bz1, bz2, az0, az1, az2;	// coefs for discrete-time filter.
+
+	// For easier looking code...unpack
+	b0 = acoefs[0]; b1 = acoefs[1]; b2 = acoefs[2];
+    a0 = acoefs[3]; a1 = acoefs[4]; a2 = acoefs[5];
+
+    double T = 1/fs;
+    double Tsq = T*T;
+
+    // we need to normalize because the biquad struct assumes az0 = 1
+
+    az0 = ( a0*Tsq + 2*a1*T + 4*a2 );
+    az1 = ( 2*a0*Tsq - 8*a2 ) / az0;
+    az2 = ( a0*Tsq - 2*a1*T + 4*a2 ) / az0;
+
+	bz0 = ( b0*Tsq + 2*b1*T + 4*b2 ) / az0;
+    bz1 = ( 2*b0*Tsq - 8*b2 ) / az0;
+    bz2 = ( b0*Tsq - 2*b1*T + 4*b2 ) / az0;
+
+    az0 = 1;
+
+	// return coefficients to the output
+	dcoefs[0] = bz0; dcoefs[1] = bz1; dcoefs[2] = bz2;
+    dcoefs[3] = az1; dcoefs[4] = az2;
+
+}
+
+
+//------------------------------------------------------------------------------
+void ConvReverb::designParametric(double* dcoefs, double center, double gain, double qval)
+// design parametric filter based on input center frequency, gain (dB), Q and sampling rate
+{
+	double b0, b1, b2, a0, a1, a2;		//storage for continuous-time filter coefs
+	double acoefs[6];
+
+    // in radians
+    center *= 2*M_PI;
+
+    // pre-warping
+    center = 2*fs*tan(center/(2*fs));
+
+    // take gain from dB to linear space
+    gain = dB2mag( gain );
+
+    // analog coeffs
+    b0 = 1.0;
+    b1 = (gain > 1.0) ? gain / ( center * qval ) : 1.0 / ( center * qval ) ;
+    b2 = 1.0 / ( center * center );
+
+    a0 = 1.0;
+    a1 = (gain > 1.0) ? 1.0 / ( center * qval ) : 1.0 / ( center * gain * qval );
+    a2 = 1.0 / ( center * center );
+
+	// pack the analog coeffs into an array and apply the bilinear tranform
+	acoefs[0] = b0; acoefs[1] = b1; acoefs[2] = b2;
+    acoefs[3] = a0; acoefs[4] = a1; acoefs[5] = a2;
+
+	// inputs the 6 analog coeffs, output the 5 digital coeffs
+	bilinearTransform(acoefs, dcoefs);
+
+}
@@ -0,0 +1,196 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : ConvReverb.h
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  : Convolution reverb with a measured impulse response. Same
+//              controls as the Reverb FDN plugin (wet/dry and the
+//              parametric section on the wet signal).
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __ConvReverb__
+#define __ConvReverb__
+
+#include "Convolver.h"
+#include "WaveFile.h"
+#include "public.sdk/source/vst2.x/audioeffectx.h"
+#include <math.h>
+
+#ifndef dB
+// if below -100dB, set to -100dB to prevent taking log of zero
+#define dB(x)               20.0 * ((x) > 0.00001 ? log10(x) : log10(0.00001))
+#endif
+
+#ifndef dB2mag
+#define dB2mag(x)           pow( 10.0, (x) / 20.0 )
+#endif
+
+#define kMaxBlock			256				// frames per internal block
+#define kDefaultIRPath		"impulse.wav"	// used when CONVREVERB_IR is not set
+#define kDefaultIRLength	2.0				// seconds of the built-in decaying-noise IR
+#define kResampleZeros		32				// sinc zero crossings either side of each resampled point
+#define kResampleTable		512				// kernel table points per zero crossing
+#define kResampleCutoff		0.9				// of the lower Nyquist; the transition ends below it
+#define kResampleBeta		7.86			// Kaiser window, 80 dB of stopband
+
+
+//------------------------------------------------------------------------------
+// signal processing functions
+struct Biquad {
+    //  biquad filter section
+    double	b0, b1, b2, a1, a2, z1, z2;
+
+    Biquad() {
+        this->b0=1.0;
+        this->b1=0.0;
+        this->b2=0.0;
+        this->a1=0.0;
+        this->a2=0.0;
+        reset();
+    }
+    void setCoefs(double* coefs) {
+        // set filter coefficients [b0 b1 b2 a1 a2]
+        this->b0=*(coefs);
+        this->b1=*(coefs+1);
+        this->b2=*(coefs+2);
+        this->a1=*(coefs+3);
+        this->a2=*(coefs+4);
+    }
+    void reset() {
+        // reset filter state
+        z1=0;
+        z2=0;
+    }
+    void process (double input, double& output) {
+        // process input sample, direct form II transposed
+        output = z1 + input*b0;
+        z1 = z2 + input*b1 - output*a1;
+        z2 = input*b2 - output*a2;
+    }
+};
+
+
+//------------------------------------------------------------------------------
+class ConvReverb : public AudioEffectX
+{
+public:
+	ConvReverb (audioMasterCallback audioMaster);
+	~ConvReverb ();
+
+	// Processing
+	virtual void processReplacing (float** inputs, float** outputs, VstInt32 sampleFrames);
+	virtual void setSampleRate (float sampleRate);
+	virtual void resume ();
+	virtual VstInt32 getGetTailSize ();
+
+	// Program
+	virtual void setProgramName (char* name);
+	virtual void getProgramName (char* name);
+
+	// Parameters
+	virtual void setParameter (VstInt32 index, float value);
+	virtual float getParameter (VstInt32 index);
+	virtual void getParameterLabel (VstInt32 index, char* label);
+	virtual void getParameterDisplay (VstInt32 index, char* text);
+	virtual void getParameterName (VstInt32 index, char* text);
+
+	virtual bool getEffectName (char* name);
+	virtual bool getVendorString (char* text);
+	virtual bool getProductString (char* text);
+	virtual VstInt32 getVendorVersion ();
+
+	bool loadImpulse(const char* path);			// WAV file; call while suspended
+	void makeDefaultImpulse();					// decaying stereo noise
+    void bilinearTransform(double acoefs[], double dcoefs[]);
+    void designParametric(double* dcoefs, double center, double gain, double qval);
+
+protected:
+	void prepareImpulse();						// resample, normalize and load into the convolver
+
+	// param IDs
+	enum {
+		kParamWetDry	= 0,
+        kParamQ,
+        kParamGamma,
+        kParamFc,
+		kNumParams
+	};
+
+	// knob vars
+	float WetDryKnob; // since the mix in the [0,1] range, we can use the knob value directly
+    float ParametricQKnob, ParametricQValue;
+    float ParametricGammaKnob, ParametricGammaValue;	// gain in dB
+    float ParametricFcKnob, ParametricFcValue;
+
+	// config
+	enum {
+		kNumProgs	= 1,
+		kNumInputs	= 2,
+		kNumOutputs	= 2
+	};
+
+	char	programName[kVstMaxProgNameLen + 1];
+
+	// internal state var declaration and initialization
+	double fs;
+	WaveFile ir;										// impulse response as loaded
+	PartitionedConvolver conv;
+
+    // parametric section
+    double parametric_coefs[5];
+    Biquad parametric[2];
+
+    // block buffers between the host and the convolver
+    double dry[2][kMaxBlock];
+    double wet[2][kMaxBlock];
+};
+
+
+// UI controls limits and tapers
+const static float ParametricGammaLimits[2] = {-24.0, 24.0};
+const static float ParametricGammaTaper = 1.0;
+
+const static float ParametricFcLimits[2] = {50.0, 16000.0};
+const static float ParametricFcTaper = -1.0;
+
+const static float ParametricQLimits[2] = {0.25, 32.0};
+const static float ParametricQTaper = -1.0;
+
+
+
+//------------------------------------------------------------------------------
+// "static" class to faciliate the knob handling
+class SmartKnob {
+public:
+    // convert knob on [0,1] to value in [limits[0],limits[1]] according to taper
+    static float knob2value(float knob, const float *limits, float taper)
+    {
+        float value;
+        if (taper > 0.0) {  // algebraic taper
+            value = limits[0] + (limits[1] - limits[0]) * pow(knob, taper);
+        } else {            // exponential taper
+            value = limits[0] * exp(log(limits[1]/limits[0]) * knob);
+        }
+        return value;
+    };
+
+    // convert value in [limits[0],limits[1]] to knob on [0,1] according to taper
+    static float value2knob(float value, const float *limits, float taper)
+    {
+        float knob;
+        if (taper > 0.0) {  // algebraic taper
+            knob = pow((value - limits[0])/(limits[1] - limits[0]), 1.0/taper);
+        } else {            // exponential taper
+            knob = log(value/limits[0])/log(limits[1]/limits[0]);
+        }
+        return knob;
+    };
+
+};
+
+
+
+#endif	// __ConvReverb__
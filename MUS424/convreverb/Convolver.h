@@ -0,0 +1,434 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : Convolver.h
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  : Zero-latency, non-uniformly partitioned stereo convolution.
+//              The impulse response is split into stages:
+//                [0, 64)             direct-form FIR, per sample
+//                [64, 3072)          FFT partitions of 64, audio thread
+//                [3072, 24576)       FFT partitions of 1024, worker thread
+//                [24576, end)        FFT partitions of 8192, worker thread
+//              The audio thread's stage starts at L, its block length: a
+//              block is convolved the moment it is complete and its output
+//              is due from the next sample on, so the sum has no latency. The worker's stages start at 3L: a block is
+//              queued as soon as it is complete and collected two block
+//              periods later, so the worker has two periods for it and the
+//              audio thread never waits on it. A block still queued at its
+//              deadline is done by the audio thread; one the worker is still
+//              in the middle of plays as silence (the worker is hopelessly
+//              behind by then). Bigger blocks further out keep the
+//              frequency-domain delay lines (and the memory traffic) small
+//              for long IRs.
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __Convolver__
+#define __Convolver__
+
+#include "FFT.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <limits.h>
+#include <string.h>
+
+#define kHeadLen		64			// direct FIR length, and the audio thread's FFT block
+#define kTailBlock		1024		// first background FFT block
+#define kNumTailStages	2			// background stages, each block 8x the last
+#define kTailJobs		2			// blocks a background stage can have in flight
+
+
+//------------------------------------------------------------------------------
+//  one uniformly partitioned overlap-save stage for one channel: B samples
+//  in, B samples of (input * segment) out, one block late
+struct ConvStage {
+	int		B, parts, slot;
+	RealFFT	fft;							// 2B points
+	double	*hre, *him;						// partition spectra, parts x (B+1)
+	double	*xre, *xim;						// frequency-domain delay line of past input blocks
+	double	*accre, *accim;					// B+1
+	double	*window;						// 2B: previous block, current block
+	double	*time;							// 2B
+
+	ConvStage()		{	B = 0; parts = 0; slot = 0; hre = him = xre = xim = accre = accim = window = time = 0;	}
+	~ConvStage()	{	Free();	}
+
+	void Free()
+	{
+		delete[] hre; delete[] him; delete[] xre; delete[] xim;
+		delete[] accre; delete[] accim; delete[] window; delete[] time;
+		hre = him = xre = xim = accre = accim = window = time = 0;
+		parts = 0;
+	}
+
+	// partition len samples of seg into blocks of size; not real-time safe
+	void Init(const double* seg, long len, int size)
+	{
+		Free();
+		B = size;
+		parts = (len > 0) ? (int)((len + B - 1)/B) : 0;
+		if (parts == 0)
+			return;
+		int bins = B+1;
+		fft.Init(2*B);
+		hre = new double[parts*bins]; him = new double[parts*bins];
+		xre = new double[parts*bins]; xim = new double[parts*bins];
+		accre = new double[bins]; accim = new double[bins];
+		window = new double[2*B]; time = new double[2*B];
+		for (int p=0; p<parts; p++) {
+			long n = len - (long)p*B;
+			if (n > B) n = B;
+			memset(time, 0, 2*B*sizeof(double));
+			memcpy(time, seg + (long)p*B, n*sizeof(double));
+			fft.Forward(time, hre + p*bins, him + p*bins);
+		}
+		Reset();
+	}
+
+	void Reset()
+	{
+		if (parts == 0)
+			return;
+		memset(xre, 0, parts*(B+1)*sizeof(double)); memset(xim, 0, parts*(B+1)*sizeof(double));
+		memset(window, 0, 2*B*sizeof(double));
+		slot = 0;
+	}
+
+	void Process(const double* in, double* out)
+	{
+		int bins = B+1, p, k;
+		if (parts == 0) {
+			memset(out, 0, B*sizeof(double));
+			return;
+		}
+		memcpy(window, window+B, B*sizeof(double));
+		memcpy(window+B, in, B*sizeof(double));
+		slot = (slot + 1) % parts;
+		fft.Forward(window, xre + slot*bins, xim + slot*bins);
+
+		// complex multiply-accumulate over the partitions, four bins at a time so
+		// the sums stay in registers instead of going back to memory every pass
+		for (k=0; k+4<=bins; k+=4) {
+			double r0 = 0.0, r1 = 0.0, r2 = 0.0, r3 = 0.0, i0 = 0.0, i1 = 0.0, i2 = 0.0, i3 = 0.0;
+			int s = slot;
+			for (p=0; p<parts; p++) {
+				const double *ar = xre + s*bins + k, *ai = xim + s*bins + k;
+				const double *br = hre + p*bins + k, *bi = him + p*bins + k;
+				r0 += ar[0]*br[0] - ai[0]*bi[0]; i0 += ar[0]*bi[0] + ai[0]*br[0];
+				r1 += ar[1]*br[1] - ai[1]*bi[1]; i1 += ar[1]*bi[1] + ai[1]*br[1];
+				r2 += ar[2]*br[2] - ai[2]*bi[2]; i2 += ar[2]*bi[2] + ai[2]*br[2];
+				r3 += ar[3]*br[3] - ai[3]*bi[3]; i3 += ar[3]*bi[3] + ai[3]*br[3];
+				if (--s < 0) s = parts-1;				// input block p blocks ago
+			}
+			accre[k] = r0; accre[k+1] = r1; accre[k+2] = r2; accre[k+3] = r3;
+			accim[k] = i0; accim[k+1] = i1; accim[k+2] = i2; accim[k+3] = i3;
+		}
+		for (; k<bins; k++) {
+			double re = 0.0, im = 0.0;
+			int s = slot;
+			for (p=0; p<parts; p++) {
+				double ar = xre[s*bins+k], ai = xim[s*bins+k], br = hre[p*bins+k], bi = him[p*bins+k];
+				re += ar*br - ai*bi; im += ar*bi + ai*br;
+				if (--s < 0) s = parts-1;
+			}
+			accre[k] = re; accim[k] = im;
+		}
+		fft.Inverse(accre, accim, time);
+		memcpy(out, time+B, B*sizeof(double));			// overlap-save: the last B are valid
+	}
+};
+
+
+//------------------------------------------------------------------------------
+//  a stage run on the worker thread: blocks of L samples are queued when
+//  complete and their output is collected two blocks later
+struct TailStage {
+	int		L, pos;
+	long	offset;									// where this stage's segment starts in the IR (3L)
+	long	block;									// blocks completed so far
+	ConvStage conv[2];
+	double	*in[2], *out[2];						// being filled / being played
+	double	*jobIn[kTailJobs][2], *jobOut[kTailJobs][2];	// handed to whoever runs the job
+	long	jobBlock[kTailJobs];					// which block each job holds
+	std::atomic<int> state[kTailJobs];
+	std::atomic<bool> busy;							// a thread is in conv[], one at a time and in order
+
+	TailStage()
+	{
+		L = 0; pos = 0; offset = 0; block = 0; busy = false;
+		for (int c=0; c<2; c++) {
+			in[c] = out[c] = 0;
+			for (int j=0; j<kTailJobs; j++)
+				jobIn[j][c] = jobOut[j][c] = 0;
+		}
+		for (int j=0; j<kTailJobs; j++) {
+			jobBlock[j] = 0;
+			state[j] = 0;
+		}
+	}
+	~TailStage()	{	Free();	}
+
+	void Free()
+	{
+		for (int c=0; c<2; c++) {
+			delete[] in[c]; delete[] out[c];
+			in[c] = out[c] = 0;
+			for (int j=0; j<kTailJobs; j++) {
+				delete[] jobIn[j][c]; delete[] jobOut[j][c];
+				jobIn[j][c] = jobOut[j][c] = 0;
+			}
+			conv[c].Free();
+		}
+	}
+
+	void Init(int size)
+	{
+		Free();
+		L = size; offset = 3*(long)size;
+		for (int c=0; c<2; c++) {
+			in[c] = new double[L]; out[c] = new double[L];
+			for (int j=0; j<kTailJobs; j++) {
+				jobIn[j][c] = new double[L]; jobOut[j][c] = new double[L];
+			}
+		}
+		Reset();
+	}
+
+	void Reset()
+	{
+		for (int c=0; c<2; c++) {
+			memset(in[c], 0, L*sizeof(double)); memset(out[c], 0, L*sizeof(double));
+			conv[c].Reset();
+		}
+		for (int j=0; j<kTailJobs; j++)
+			state[j] = 0;
+		pos = 0;
+		block = 0;
+	}
+};
+
+
+//------------------------------------------------------------------------------
+class PartitionedConvolver {
+public:
+	PartitionedConvolver()
+	{
+		length = 0; numTails = 0; quit = false; pending = false;
+		for (int t=0; t<kNumTailStages; t++)
+			tails[t].Init(kTailBlock << (3*t));			// 1024, 8192, ...
+		Reset();
+	}
+	~PartitionedConvolver()
+	{
+		if (worker.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(wakeLock);
+				quit = true;
+			}
+			wake.notify_one();
+			worker.join();
+		}
+	}
+
+	// load an impulse response of len frames, 1 or 2 channels (mono feeds both
+	// sides); allocates and may start the worker, so call while suspended
+	void SetImpulse(double* const* ir, int irChannels, long len)
+	{
+		FinishJobs();
+		length = len;
+		numTails = 0;
+		for (int c=0; c<2; c++) {
+			const double* h = ir[(irChannels > 1) ? c : 0];
+			memset(head[c], 0, sizeof(head[c]));
+			memcpy(head[c], h, ((len < kHeadLen) ? len : kHeadLen)*sizeof(double));
+			long end = (len < tails[0].offset) ? len : tails[0].offset;
+			if (end > kHeadLen)
+				mid[c].Init(h + kHeadLen, end - kHeadLen, kHeadLen);
+			else
+				mid[c].Free();
+			for (int t=0; t<kNumTailStages; t++) {
+				long start = tails[t].offset;
+				end = (t+1 < kNumTailStages) ? tails[t+1].offset : len;
+				if (end > len) end = len;
+				if (end > start) {
+					tails[t].conv[c].Init(h + start, end - start, tails[t].L);
+					numTails = t+1;
+				} else {
+					tails[t].conv[c].Free();
+				}
+			}
+		}
+		if (numTails > 0 && !worker.joinable())
+			worker = std::thread(&PartitionedConvolver::WorkerLoop, this);
+		Reset();
+	}
+
+	long GetLength()	{	return length;	}
+
+	void Reset()
+	{
+		FinishJobs();
+		memset(hist, 0, sizeof(hist));
+		memset(midIn, 0, sizeof(midIn)); memset(midOut, 0, sizeof(midOut));
+		for (int c=0; c<2; c++)
+			mid[c].Reset();
+		for (int t=0; t<kNumTailStages; t++)
+			tails[t].Reset();
+		hpos = 0; midPos = 0;
+	}
+
+	// convolve n frames; outputs are overwritten
+	void Process(const double* inL, const double* inR, double* outL, double* outR, int n)
+	{
+		const double* in[2] = {inL, inR};
+		double* out[2] = {outL, outR};
+		int t;
+		for (int i=0; i<n; i++) {
+			hpos = (hpos == 0) ? kHeadLen-1 : hpos-1;
+			for (int c=0; c<2; c++) {
+				double x = in[c][i];
+				hist[c][hpos] = hist[c][hpos+kHeadLen] = x;	// doubled ring: newest first, contiguous
+				const double *hx = hist[c] + hpos, *hc = head[c];
+				double y0 = 0.0, y1 = 0.0, y2 = 0.0, y3 = 0.0;	// independent sums, so it vectorises
+				for (int k=0; k<kHeadLen; k+=4) {
+					y0 += hc[k]*hx[k]; y1 += hc[k+1]*hx[k+1];
+					y2 += hc[k+2]*hx[k+2]; y3 += hc[k+3]*hx[k+3];
+				}
+				double y = (y0 + y1) + (y2 + y3) + midOut[c][midPos];
+				midIn[c][midPos] = x;
+				for (t=0; t<numTails; t++) {
+					y += tails[t].out[c][tails[t].pos];
+					tails[t].in[c][tails[t].pos] = x;
+				}
+				out[c][i] = y;
+			}
+			if (++midPos == kHeadLen) {					// block complete: next kHeadLen outputs
+				mid[0].Process(midIn[0], midOut[0]);
+				mid[1].Process(midIn[1], midOut[1]);
+				midPos = 0;
+			}
+			for (t=0; t<numTails; t++)
+				if (++tails[t].pos == tails[t].L) {
+					SwapJob(tails[t]);
+					tails[t].pos = 0;
+				}
+		}
+	}
+
+protected:
+	enum { kJobIdle = 0, kJobQueued, kJobRunning, kJobDone };
+
+	// the stage's block from two periods ago is due now: collect it, then
+	// queue the one that just completed in its place. Nothing here waits on
+	// the worker: if it holds wakeLock (only while checking pending), the
+	// new block is done here instead of risking a missed wake-up.
+	void SwapJob(TailStage& s)
+	{
+		int c, j = (int)(s.block % kTailJobs);
+		int st = s.state[j].load();
+		if (st == kJobQueued) {								// not started: do it here
+			RunJobs(s, s.jobBlock[j]);
+			st = s.state[j].load();
+		}
+		bool ready = (st == kJobDone && s.jobBlock[j] == s.block - kTailJobs);
+		for (c=0; c<2; c++) {
+			if (ready)
+				memcpy(s.out[c], s.jobOut[j][c], s.L*sizeof(double));
+			else
+				memset(s.out[c], 0, s.L*sizeof(double));	// nothing queued yet, or late
+		}
+		if (st == kJobDone || st == kJobIdle) {
+			for (c=0; c<2; c++)
+				memcpy(s.jobIn[j][c], s.in[c], s.L*sizeof(double));
+			s.jobBlock[j] = s.block;
+			s.state[j].store(kJobQueued);
+			std::unique_lock<std::mutex> lock(wakeLock, std::try_to_lock);
+			if (lock.owns_lock()) {
+				pending = true;
+				wake.notify_one();
+			} else {
+				RunJobs(s, s.block);
+			}
+		}													// else the worker is still on it: this block is lost
+		s.block++;
+	}
+
+	// run the stage's queued blocks in order, up to block last, unless another
+	// thread is already at it; returns false if one is
+	static bool RunJobs(TailStage& s, long last)
+	{
+		bool expected = false;
+		if (!s.busy.compare_exchange_strong(expected, true))
+			return false;
+		for (;;) {
+			int next = -1;
+			for (int j=0; j<kTailJobs; j++)
+				if (s.state[j].load() == kJobQueued && s.jobBlock[j] <= last
+					&& (next < 0 || s.jobBlock[j] < s.jobBlock[next]))
+					next = j;
+			if (next < 0)
+				break;
+			s.state[next].store(kJobRunning);
+			s.conv[0].Process(s.jobIn[next][0], s.jobOut[next][0]);
+			s.conv[1].Process(s.jobIn[next][1], s.jobOut[next][1]);
+			s.state[next].store(kJobDone);
+		}
+		s.busy.store(false);
+		return true;
+	}
+
+	// wait for any job in flight and drop the rest; not real-time safe
+	void FinishJobs()
+	{
+		for (int t=0; t<kNumTailStages; t++) {
+			bool expected = false;
+			while (!tails[t].busy.compare_exchange_weak(expected, true)) {
+				expected = false;
+				std::this_thread::yield();
+			}
+			for (int j=0; j<kTailJobs; j++)
+				tails[t].state[j].store(kJobIdle);
+			tails[t].busy.store(false);
+		}
+	}
+
+	void WorkerLoop()
+	{
+		std::unique_lock<std::mutex> lock(wakeLock);
+		for (;;) {
+			wake.wait(lock, [this] { return pending || quit; });
+			if (quit)
+				break;
+			pending = false;
+			lock.unlock();
+			for (int t=0; t<kNumTailStages; t++)			// shortest deadline first
+				RunJobs(tails[t], LONG_MAX);
+			lock.lock();
+		}
+	}
+
+	long	length;
+
+	double	head[2][kHeadLen];						// first kHeadLen taps
+	double	hist[2][2*kHeadLen];					// input history for the head
+	int		hpos;
+
+	ConvStage mid[2];								// audio thread partitions
+	double	midIn[2][kHeadLen], midOut[2][kHeadLen];
+	int		midPos;
+
+	TailStage tails[kNumTailStages];				// worker thread partitions
+	int		numTails;								// stages the IR actually reaches
+
+	bool					quit, pending;			// both under wakeLock
+	std::thread				worker;
+	std::mutex				wakeLock;
+	std::condition_variable	wake;
+};
+
+
+#endif	// __Convolver__
@@ -0,0 +1,131 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : FFT.h
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  : Real FFT of a power-of-two size, computed with a half-size
+//              complex radix-2 FFT. Spectra are kept as separate real and
+//              imaginary arrays of size/2+1 bins, which is what the
+//              convolution's multiply-accumulate loops want.
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __FFT__
+#define __FFT__
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI				3.14159265358979323846
+#endif
+
+
+//------------------------------------------------------------------------------
+struct RealFFT {
+	int		n, h;					// real size, and the complex size n/2
+	int*	rev;					// bit reversal permutation of h points
+	double	*twr, *twi;				// per-stage twiddles, stage len at [len/2-1, len-1)
+	double	*pr, *pi;				// exp(-2 pi i k/n), k <= h
+	double	*zr, *zi;				// work space, h points
+
+	RealFFT()	{	n = h = 0; rev = 0; twr = twi = pr = pi = zr = zi = 0;	}
+	~RealFFT()	{	Free();	}
+
+	// allocate tables for size points (a power of two, 4 or more); not real-time safe
+	void Init(int size)
+	{
+		int k, bits = 0;
+		Free();
+		n = size; h = size/2;
+		while ((1 << bits) < h) bits++;
+		rev = new int[h];
+		twr = new double[h]; twi = new double[h];
+		pr = new double[h+1]; pi = new double[h+1];
+		zr = new double[h]; zi = new double[h];
+		for (k=0; k<h; k++) {
+			int r = 0;
+			for (int b=0; b<bits; b++)
+				if (k & (1 << b)) r |= 1 << (bits-1-b);
+			rev[k] = r;
+		}
+		for (int len=2; len<=h; len<<=1)					// contiguous per stage, so the
+			for (k=0; k<len/2; k++) {						// butterfly loop walks memory linearly
+				twr[len/2-1+k] = cos(2*M_PI*k/len); twi[len/2-1+k] = -sin(2*M_PI*k/len);
+			}
+		for (k=0; k<=h; k++) {
+			pr[k] = cos(2*M_PI*k/n); pi[k] = -sin(2*M_PI*k/n);
+		}
+	}
+
+	void Free()
+	{
+		delete[] rev; delete[] twr; delete[] twi; delete[] pr; delete[] pi; delete[] zr; delete[] zi;
+		rev = 0; twr = twi = pr = pi = zr = zi = 0;
+	}
+
+	// n real samples in, h+1 complex bins out
+	void Forward(const double* x, double* re, double* im)
+	{
+		int k;
+		for (k=0; k<h; k++) {
+			zr[k] = x[2*k]; zi[k] = x[2*k+1];				// even samples real, odd imaginary
+		}
+		Complex(zr, zi);
+		for (k=0; k<=h; k++) {
+			int a = (k == h) ? 0 : k, b = (k == 0) ? 0 : h-k;
+			double er = 0.5*(zr[a] + zr[b]), ei = 0.5*(zi[a] - zi[b]);	// spectrum of the even samples
+			double or_ = 0.5*(zi[a] + zi[b]), oi = -0.5*(zr[a] - zr[b]);	// and of the odd ones
+			re[k] = er + or_*pr[k] - oi*pi[k];
+			im[k] = ei + or_*pi[k] + oi*pr[k];
+		}
+	}
+
+	// h+1 complex bins in, n real samples out (scaled, so Inverse(Forward(x)) = x)
+	void Inverse(const double* re, const double* im, double* x)
+	{
+		int k;
+		for (k=0; k<h; k++) {
+			double er = 0.5*(re[k] + re[h-k]), ei = 0.5*(im[k] - im[h-k]);
+			double dr = 0.5*(re[k] - re[h-k]), di = 0.5*(im[k] + im[h-k]);
+			double or_ = dr*pr[k] + di*pi[k], oi = di*pr[k] - dr*pi[k];	// times exp(+2 pi i k/n)
+			zr[k] = er - oi; zi[k] = ei + or_;
+		}
+		Complex(zi, zr);									// swapped in and out: an inverse FFT
+		double scale = 1.0/h;
+		for (k=0; k<h; k++) {
+			x[2*k] = zr[k]*scale; x[2*k+1] = zi[k]*scale;
+		}
+	}
+
+protected:
+	// in-place forward complex FFT of h points, decimation in time
+	void Complex(double* r, double* i)
+	{
+		int k, len;
+		for (k=0; k<h; k++) {
+			int j = rev[k];
+			if (j > k) {
+				double t = r[k]; r[k] = r[j]; r[j] = t;
+				t = i[k]; i[k] = i[j]; i[j] = t;
+			}
+		}
+		for (len=2; len<=h; len<<=1) {
+			int half = len/2;
+			const double *wr = twr + half-1, *wi = twi + half-1;
+			for (int s=0; s<h; s+=len) {
+				double *ra = r+s, *ia = i+s, *rb = r+s+half, *ib = i+s+half;
+				for (k=0; k<half; k++) {
+					double tr = rb[k]*wr[k] - ib[k]*wi[k], ti = rb[k]*wi[k] + ib[k]*wr[k];
+					rb[k] = ra[k] - tr; ib[k] = ia[k] - ti;
+					ra[k] += tr; ia[k] += ti;
+				}
+			}
+		}
+	}
+};
+
+
+#endif	// __FFT__
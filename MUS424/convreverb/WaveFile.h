@@ -0,0 +1,145 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : WaveFile.h
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  : Minimal RIFF/WAVE reader for impulse responses: 16/24/32-bit
+//              PCM and 32/64-bit float, plain or WAVE_FORMAT_EXTENSIBLE. The
+//              first two channels are kept, deinterleaved to double.
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __WaveFile__
+#define __WaveFile__
+
+#include <stdio.h>
+#include <string.h>
+
+
+//------------------------------------------------------------------------------
+struct WaveFile {
+	int		channels;				// 1 or 2 (extra channels in the file are dropped)
+	long	frames;
+	double	sampleRate;
+	double*	data[2];				// one array per channel
+
+	WaveFile()	{	channels = 0; frames = 0; sampleRate = 0.0; data[0] = data[1] = 0;	}
+	~WaveFile()	{	Free();	}
+
+	void Free()
+	{
+		delete[] data[0]; delete[] data[1];
+		data[0] = data[1] = 0;
+		channels = 0; frames = 0;
+	}
+
+	// allocate an empty buffer (for impulse responses made in code)
+	void Allocate(int numChannels, long numFrames, double rate)
+	{
+		Free();
+		channels = numChannels; frames = numFrames; sampleRate = rate;
+		for (int c=0; c<channels; c++) {
+			data[c] = new double[frames];
+			memset(data[c], 0, frames*sizeof(double));
+		}
+	}
+
+	// read a file; returns false (and leaves the buffer empty) if it can't
+	bool Load(const char* path)
+	{
+		Free();
+		FILE* f = fopen(path, "rb");
+		if (!f)
+			return false;
+
+		unsigned char hdr[12], ck[8], fmt[40];
+		int format = 0, fileChannels = 0, bits = 0;
+		double rate = 0.0;
+		bool ok = false;
+		long fileSize = (fseek(f, 0, SEEK_END) == 0) ? ftell(f) : -1;
+		if (fileSize < 12 || fseek(f, 0, SEEK_SET) != 0
+			|| fread(hdr, 1, 12, f) != 12 || memcmp(hdr, "RIFF", 4) || memcmp(hdr+8, "WAVE", 4)) {
+			fclose(f);
+			return false;
+		}
+		while (fread(ck, 1, 8, f) == 8) {
+			// no chunk runs past the end of the file: streamed files leave the
+			// sizes at 0xFFFFFFFF, and a broken one can say anything
+			unsigned long size = Le32(ck+4);
+			unsigned long left = (unsigned long)(fileSize - ftell(f));
+			if (size > left)
+				size = left;
+			if (!memcmp(ck, "fmt ", 4)) {
+				unsigned long keep = (size < 40) ? size : 40;
+				if (keep < 16 || fread(fmt, 1, keep, f) != keep) break;
+				fseek(f, (long)(size - keep + (size & 1)), SEEK_CUR);
+				format = Le16(fmt);
+				fileChannels = Le16(fmt+2);
+				rate = (double)Le32(fmt+4);
+				bits = Le16(fmt+14);
+				if (format == 0xFFFE && keep >= 26)		// WAVE_FORMAT_EXTENSIBLE: subformat GUID
+					format = Le16(fmt+24);
+				if (rate <= 0.0 || fileChannels == 0)
+					break;
+			} else if (!memcmp(ck, "data", 4) && fileChannels > 0) {
+				ok = ReadData(f, size, format, fileChannels, bits, rate);
+				break;
+			} else {
+				fseek(f, (long)(size + (size & 1)), SEEK_CUR);	// skip chunks we don't need
+			}
+		}
+		fclose(f);
+		if (!ok)
+			Free();
+		return ok;
+	}
+
+protected:
+	static unsigned int Le16(const unsigned char* p)	{	return p[0] | (p[1] << 8);	}
+	static unsigned int Le32(const unsigned char* p)	{	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);	}
+
+	bool ReadData(FILE* f, unsigned long size, int format, int fileChannels, int bits, double rate)
+	{
+		int bytes = bits/8;
+		bool pcm = (format == 1 && (bits == 16 || bits == 24 || bits == 32));
+		bool flt = (format == 3 && (bits == 32 || bits == 64));
+		if (!pcm && !flt)
+			return false;
+
+		long numFrames = (long)(size / (bytes*fileChannels));
+		if (numFrames < 1)
+			return false;
+		Allocate(fileChannels > 1 ? 2 : 1, numFrames, rate);
+		unsigned char frame[8*64];
+		if (bytes*fileChannels > (int)sizeof(frame))
+			return false;
+		for (long i=0; i<numFrames; i++) {
+			if (fread(frame, bytes, fileChannels, f) != (size_t)fileChannels)
+				return false;
+			for (int c=0; c<channels; c++) {
+				const unsigned char* p = frame + c*bytes;
+				double v;
+				if (flt && bits == 32) {
+					unsigned int u = Le32(p); float x; memcpy(&x, &u, 4); v = x;
+				} else if (flt) {
+					unsigned long long u = Le32(p) | ((unsigned long long)Le32(p+4) << 32);
+					memcpy(&v, &u, 8);
+				} else if (bits == 16) {
+					v = (short)Le16(p) / 32768.0;
+				} else if (bits == 24) {
+					int s = (int)(p[0] << 8 | p[1] << 16 | (unsigned int)p[2] << 24) >> 8;
+					v = s / 8388608.0;
+				} else {
+					v = (int)Le32(p) / 2147483648.0;
+				}
+				data[c][i] = v;
+			}
+		}
+		return true;
+	}
+};
+
+
+#endif	// __WaveFile__
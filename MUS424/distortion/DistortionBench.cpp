@@ -0,0 +1,219 @@
+//------------------------------------------------------------------------------
+// Command-line tool
+//
+// Filename     : DistortionBench.cpp
+// Created by   : music424 staff
+// Company      : CCRMA - Stanford University
+// Description  : Aliasing against speed for the Distortion's waveshaper, for
+//                each curve, oversampling factor and antiderivative order. A
+//                sine is stepped through a sweep of frequencies and run through
+//                the same upsample, shape, downsample loop as the plug-in. For
+//                each tone, everything in the audio band that is not one of its
+//                harmonics has folded back from above Nyquist. A tone's alias
+//                floor is the largest such line, in dB under the fundamental;
+//                reported are the worst and the median over the sweep. Also
+//                reported: the cost per stereo frame, and how much the top
+//                tone's fundamental drops against 16x without ADAA. The
+//                averaging is a lowpass, cos(pi f/fs) at first order and
+//                (1 + 2 cos(2 pi f/fs))/3 at second, at the shaper's rate.
+//
+//                g++ -O2 DistortionBench.cpp -o DistortionBench
+//
+//                DistortionBench [options]
+//                  -r rate       sample rate, Hz (44100)
+//                  -a amplitude  peak of the sine; the curves clip at 1 (4)
+//                  -t tones      tones in the sweep (12)
+//                  -lo Hz        lowest tone (500)
+//                  -hi Hz        highest tone (16000, and under 0.45 of the rate)
+//                  -n passes     renders to time, the fastest is reported (3)
+//                  -m phase      linear or minimum phase filters (linear)
+//
+//                The summary goes to stdout as "name: value" lines, named
+//                curve_os<factor>_adaa<order>_<measure>.
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#include "Oversampler.h"
+#include "Antiderivative.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define kFFTSize            16384
+#define kPreroll            4096        // samples to settle before the analysis
+#define kHarmonicWidth      6           // bins either side of a harmonic, the window's main lobe
+#define kAudioBand          20000.0     // Hz
+#define kMaxTones           64
+
+
+//------------------------------------------------------------------------------
+// in-place radix-2 complex FFT of n points, n a power of two
+static void fft(double* re, double* im, int n)
+{
+	int i, j, k;
+	for (i = 1, j = 0; i < n; i++) {
+		int bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j) {
+			double t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+	}
+	for (int len = 2; len <= n; len <<= 1) {
+		double a = -2.0*M_PI/len;
+		for (k = 0; k < len/2; k++) {
+			double wr = cos(a*k), wi = sin(a*k);
+			for (i = k; i < n; i += len) {
+				int q = i + len/2;
+				double xr = re[q]*wr - im[q]*wi, xi = re[q]*wi + im[q]*wr;
+				re[q] = re[i] - xr; im[q] = im[i] - xi;
+				re[i] += xr; im[i] += xi;
+			}
+		}
+	}
+}
+
+// n samples of x through the plug-in's oversampled shaper loop, into y; the
+// right channel gets x too, for the stereo cost
+static void render(PolyphaseOversampler& os, AntiderivativeShaper* shaper,
+				   const float* x, float* y, long n)
+{
+	os.reset();
+	shaper[0].reset();
+	shaper[1].reset();
+	for (long i = 0; i < n; i++) {
+		float yR;
+		os.upsample(x[i], x[i]);
+		shaper[0].process(os.buffer[0], os.factor);
+		shaper[1].process(os.buffer[1], os.factor);
+		os.downsample(y[i], yR);
+	}
+}
+
+// power spectrum of the last kFFTSize samples of y, Blackman-Harris windowed
+static void spectrum(const float* y, double* re, double* im, double* power)
+{
+	for (int i = 0; i < kFFTSize; i++) {
+		double p = 2.0*M_PI*i/kFFTSize;
+		double w = 0.35875 - 0.48829*cos(p) + 0.14128*cos(2.0*p) - 0.01168*cos(3.0*p);
+		re[i] = y[kPreroll + i]*w;
+		im[i] = 0.0;
+	}
+	fft(re, im, kFFTSize);
+	for (int k = 0; k < kFFTSize/2; k++)
+		power[k] = re[k]*re[k] + im[k]*im[k];
+}
+
+// largest line in the audio band that is no harmonic of bin, against bin, dB
+static double aliasFloor(const double* power, int bin, double fs)
+{
+	int top = (int)(kAudioBand/fs*kFFTSize);
+	top = (top < kFFTSize/2) ? top : kFFTSize/2;
+	double worst = 1e-30;
+	for (int k = 2*kHarmonicWidth; k < top; k++) {
+		int h = (k + bin/2)/bin;		// nearest harmonic
+		if (abs(k - h*bin) <= kHarmonicWidth)
+			continue;
+		worst = (power[k] > worst) ? power[k] : worst;
+	}
+	return 10.0*log10(worst/power[bin]);
+}
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	double fs = 44100.0, amplitude = 4.0, lo = 500.0, hi = 16000.0;
+	int numTones = 12, passes = 3;
+	bool minPhase = false;
+
+	for (int a=1; a<argc; a++) {
+		const char* opt = argv[a];
+		const char* arg = (a+1 < argc) ? argv[a+1] : 0;
+		if (!arg) {
+			fprintf(stderr, "DistortionBench: %s needs a value (see the top of DistortionBench.cpp)\n", opt);
+			return 1;
+		}
+		a++;
+		if (!strcmp(opt, "-r"))					fs = atof(arg);
+		else if (!strcmp(opt, "-a"))			amplitude = atof(arg);
+		else if (!strcmp(opt, "-t"))			numTones = atoi(arg);
+		else if (!strcmp(opt, "-lo"))			lo = atof(arg);
+		else if (!strcmp(opt, "-hi"))			hi = atof(arg);
+		else if (!strcmp(opt, "-n"))			passes = atoi(arg);
+		else if (!strcmp(opt, "-m"))			minPhase = !strcmp(arg, "minimum");
+		else {
+			fprintf(stderr, "DistortionBench: unknown option %s %s\n", opt, arg);
+			return 1;
+		}
+	}
+	hi = (hi < 0.45*fs) ? hi : 0.45*fs;
+	if (fs < 8000.0 || numTones < 1 || numTones > kMaxTones || passes < 1 || lo <= 0.0 || lo > hi) {
+		fprintf(stderr, "DistortionBench: bad rate, tone count, sweep or pass count\n");
+		return 1;
+	}
+
+	// each tone on an odd bin, so no harmonic folds back onto another
+	int bins[kMaxTones];
+	for (int t = 0; t < numTones; t++) {
+		double f = (numTones > 1) ? lo*pow(hi/lo, (double)t/(numTones - 1)) : lo;
+		bins[t] = (int)(f/fs*kFFTSize) | 1;
+	}
+
+	long n = kPreroll + kFFTSize;
+	float* x = new float[numTones*n];
+	float* y = new float[n];
+	double* re = new double[kFFTSize];
+	double* im = new double[kFFTSize];
+	double* power = new double[kFFTSize/2];
+	for (int t = 0; t < numTones; t++)
+		for (long i = 0; i < n; i++)
+			x[t*n + i] = (float)(amplitude*sin(2.0*M_PI*bins[t]*i/kFFTSize));
+
+	static PolyphaseOversampler os;
+	os.setSampleRate(fs);
+	const char* curveName[2] = {"hard", "soft"};
+	for (int c = 0; c < 2; c++) {
+		int curve = (c == 0) ? AntiderivativeShaper::kHardClip : AntiderivativeShaper::kSoftClip;
+		AntiderivativeShaper shaper[2] = {AntiderivativeShaper(curve), AntiderivativeShaper(curve)};
+		double reference = 0.0;
+		for (int f = kMaxOversample; f >= 1; f >>= 1) {		// 16x first, for the reference level
+			for (int order = 0; order <= kADAAMaxOrder; order++) {
+				os.select(f, minPhase);
+				shaper[0].setOrder(order);
+				shaper[1].setOrder(order);
+				double floors[kMaxTones], best = 0.0, top = 0.0;
+				for (int t = 0; t < numTones; t++) {
+					for (int p = 0; p < passes; p++) {
+						clock_t t0 = clock();
+						render(os, shaper, x + t*n, y, n);
+						double cost = (double)(clock() - t0)/CLOCKS_PER_SEC*1e9/n;
+						if ((t == 0 && p == 0) || cost < best)
+							best = cost;
+					}
+					spectrum(y, re, im, power);
+					// in order as they come, for the median
+					double a = aliasFloor(power, bins[t], fs);
+					int j = t;
+					for (; j > 0 && floors[j-1] > a; j--)
+						floors[j] = floors[j-1];
+					floors[j] = a;
+					top = 10.0*log10(power[bins[t]]);
+				}
+				if (f == kMaxOversample && order == 0)
+					reference = top;
+				printf("%s_os%d_adaa%d_alias_floor_dbc: %.1f\n", curveName[c], f, order, floors[numTones-1]);
+				printf("%s_os%d_adaa%d_alias_median_dbc: %.1f\n", curveName[c], f, order, floors[numTones/2]);
+				printf("%s_os%d_adaa%d_ns_per_frame: %.1f\n", curveName[c], f, order, best);
+				printf("%s_os%d_adaa%d_top_tone_db: %.2f\n", curveName[c], f, order, top - reference);
+			}
+		}
+	}
+
+	delete[] x; delete[] y;
+	delete[] re; delete[] im; delete[] power;
+	return 0;
+}
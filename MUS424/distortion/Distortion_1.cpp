@@ -5,7 +5,7 @@
 // Created by   : Regina Collecchia + music424 staff
 // Company      : CCRMA - Stanford University
 // Description  : Applies upsampling -> anti-imaging -> distortion ->
-//                upsampling -> anti-aliasing
+//                upsampling -> anti-aliasing, to each channel
 // Date         : 5/4/14
 //------------------------------------------------------------------------------
 
@@ -63,15 +63,27 @@ Distortion::Distortion (audioMasterCallback audioMaster)
 	fs = getSampleRate();	// sampling rate, Hz
     
 	designParametric(InCoefs, FcInValue, GainInValue, QInValue);
-	InFilter.setCoefs(InCoefs);
+	InFilter[0].setCoefs(InCoefs);
+	InFilter[1].setCoefs(InCoefs);
     
 	designParametric(OutCoefs, FcOutValue, GainOutValue, QOutValue);
-	OutFilter.setCoefs(OutCoefs);
+	OutFilter[0].setCoefs(OutCoefs);
+	OutFilter[1].setCoefs(OutCoefs);
     
-	for (int j = 0; j < kAAOrder; j++) {
-		AIFilter[j].setCoefs((double *) AACoefs[j]);
-		AAFilter[j].setCoefs((double *) AACoefs[j]);
+	OversampleValue = 8;	// oversampling factor
+	OversampleKnob = (float) 3.0/kOSNumFactors;	// 8x, the fourth of five settings
+	PhaseKnob = (float) 0.0;	// linear phase
+	MinimumPhase = false;
+	AntialiasValue = 0;	// antiderivative antialiasing off
+	AntialiasKnob = (float) 0.0;
+	Oversampler.select(OversampleValue, MinimumPhase);
+	Oversampler.setSampleRate(fs);
+	for (int c = 0; c < kNumInputs; c++) {
+		Shaper[c].curve = AntiderivativeShaper::kHardClip;
+		Shaper[c].setOrder(AntialiasValue);
 	}
+	OversampleDirty = false;
+	setInitialDelay(latency());
     
 }
 
@@ -81,6 +93,62 @@ Distortion::~Distortion ()
 	// nothing to do here
 }
 
+//------------------------------------------------------------------------------
+void Distortion::setSampleRate (float sampleRate)
+{
+	AudioEffectX::setSampleRate(sampleRate);
+	fs = sampleRate;	// sampling rate, Hz
+    
+	// input and output filters for the new rate
+	designParametric(InCoefs, FcInValue, GainInValue, QInValue);
+	InFilter[0].setCoefs(InCoefs);
+	InFilter[1].setCoefs(InCoefs);
+	designParametric(OutCoefs, FcOutValue, GainOutValue, QOutValue);
+	OutFilter[0].setCoefs(OutCoefs);
+	OutFilter[1].setCoefs(OutCoefs);
+    
+	// oversampling filters for the new rate, unless they are the ones already
+	// made; at higher rates the linear phase ones are shorter, and delay less
+	Oversampler.select(OversampleValue, MinimumPhase);
+	Oversampler.setSampleRate(fs);
+	Shaper[0].setOrder(AntialiasValue);
+	Shaper[1].setOrder(AntialiasValue);
+	OversampleDirty = false;
+	setInitialDelay(latency());
+}
+
+//------------------------------------------------------------------------------
+void Distortion::resume ()
+{
+	// a new factor, phase or antialiasing order changes the latency, so it is
+	// taken here, where the host reads the latency, rather than in the middle
+	// of the stream
+	if (OversampleDirty) {
+		OversampleDirty = false;
+		Oversampler.select(OversampleValue, MinimumPhase);
+		Shaper[0].setOrder(AntialiasValue);
+		Shaper[1].setOrder(AntialiasValue);
+	}
+	setInitialDelay(latency());
+    
+	// clear the filters
+	for (int c = 0; c < kNumInputs; c++) {
+		InFilter[c].reset();
+		OutFilter[c].reset();
+		Shaper[c].reset();
+	}
+	Oversampler.reset();
+}
+
+//------------------------------------------------------------------------------
+long Distortion::latency ()
+// the oversampling filters' delay, and the shaper's where it comes to whole
+// samples: second order antiderivative antialiasing without oversampling
+{
+	double shaper = AntiderivativeShaper::delayFor(AntialiasValue)/OversampleValue;
+	return Oversampler.latencyFor(OversampleValue, MinimumPhase) + (long) shaper;
+}
+
 //------------------------------------------------------------------------------
 void Distortion::setProgramName (char* name)
 {
@@ -127,7 +195,8 @@ void Distortion::setParameter(VstInt32 index, float value)
             
             // design new input filter
             designParametric(InCoefs, FcInValue, GainInValue, QInValue);
-            InFilter.setCoefs(InCoefs);
+            InFilter[0].setCoefs(InCoefs);
+            InFilter[1].setCoefs(InCoefs);
             
             break;
             
@@ -138,7 +207,8 @@ void Distortion::setParameter(VstInt32 index, float value)
             
             // design new input filter
             designParametric(InCoefs, FcInValue, GainInValue, QInValue);
-            InFilter.setCoefs(InCoefs);
+            InFilter[0].setCoefs(InCoefs);
+            InFilter[1].setCoefs(InCoefs);
             
             break;
             
@@ -149,7 +219,8 @@ void Distortion::setParameter(VstInt32 index, float value)
             
             // design new input filter
             designParametric(InCoefs, FcInValue, GainInValue, QInValue);
-            InFilter.setCoefs(InCoefs);
+            InFilter[0].setCoefs(InCoefs);
+            InFilter[1].setCoefs(InCoefs);
             
             break;
             
@@ -160,7 +231,8 @@ void Distortion::setParameter(VstInt32 index, float value)
             
             // design new output filter
             designParametric(OutCoefs, FcOutValue, GainOutValue, QOutValue);
-            OutFilter.setCoefs(OutCoefs);
+            OutFilter[0].setCoefs(OutCoefs);
+            OutFilter[1].setCoefs(OutCoefs);
             
             break;
             
@@ -171,7 +243,8 @@ void Distortion::setParameter(VstInt32 index, float value)
             
             // design new output filter
             designParametric(OutCoefs, FcOutValue, GainOutValue, QOutValue);
-            OutFilter.setCoefs(OutCoefs);
+            OutFilter[0].setCoefs(OutCoefs);
+            OutFilter[1].setCoefs(OutCoefs);
             
             break;
             
@@ -182,7 +255,40 @@ void Distortion::setParameter(VstInt32 index, float value)
             
             // design new output filter
             designParametric(OutCoefs, FcOutValue, GainOutValue, QOutValue);
-            OutFilter.setCoefs(OutCoefs);
+            OutFilter[0].setCoefs(OutCoefs);
+            OutFilter[1].setCoefs(OutCoefs);
+            
+            break;
+            
+        case kParamOversample:
+            // oversampling factor, 1x (none), 2x, 4x, 8x or 16x
+            OversampleKnob = value;
+            OversampleValue = 1 << (int) (OversampleKnob*kOSNumFactors + 0.5);
+            
+            // new filters, and their latency, at the next resume()
+            OversampleDirty = true;
+            
+            break;
+            
+        case kParamPhase:
+            // oversampling filter phase, linear or minimum
+            PhaseKnob = value;
+            MinimumPhase = (PhaseKnob >= 0.5);
+            
+            // linear phase filters delay the signal, minimum phase ones don't,
+            // so they change over at the next resume() too
+            OversampleDirty = true;
+            
+            break;
+            
+        case kParamAntialias:
+            // antiderivative antialiasing, off, first or second order
+            AntialiasKnob = value;
+            AntialiasValue = (int) (AntialiasKnob*kADAAMaxOrder + 0.5);
+            
+            // second order delays by a sample without oversampling, so it
+            // changes over at the next resume() as well
+            OversampleDirty = true;
             
             break;
             
@@ -239,6 +345,21 @@ float Distortion::getParameter(VstInt32 index)
             return QOutKnob;
             break;
             
+        case kParamOversample:
+            // oversampling factor
+            return OversampleKnob;
+            break;
+            
+        case kParamPhase:
+            // oversampling filter phase
+            return PhaseKnob;
+            break;
+            
+        case kParamAntialias:
+            // antiderivative antialiasing
+            return AntialiasKnob;
+            break;
+            
         default:
             return 0.0;
 	}
@@ -290,6 +411,21 @@ void Distortion::getParameterName(VstInt32 index, char *label)
             vst_strncpy(label, " Output Filter Q ", kVstMaxParamStrLen);
             break;
             
+        case kParamOversample:
+            // oversampling factor
+            vst_strncpy(label, " Oversampling ", kVstMaxParamStrLen);
+            break;
+            
+        case kParamPhase:
+            // oversampling filter phase
+            vst_strncpy(label, " Filter Phase ", kVstMaxParamStrLen);
+            break;
+            
+        case kParamAntialias:
+            // antiderivative antialiasing
+            vst_strncpy(label, " ADAA ", kVstMaxParamStrLen);
+            break;
+            
         default :
             *label = '\0';
             break;
@@ -342,6 +478,21 @@ void Distortion::getParameterDisplay(VstInt32 index, char *text)
             float2string(QOutValue, text, kVstMaxParamStrLen);
             break;
             
+        case kParamOversample:
+            // oversampling factor
+            int2string(OversampleValue, text, kVstMaxParamStrLen);
+            break;
+            
+        case kParamPhase:
+            // oversampling filter phase
+            vst_strncpy(text, MinimumPhase ? " Minimum " : " Linear ", kVstMaxParamStrLen);
+            break;
+            
+        case kParamAntialias:
+            // antiderivative antialiasing
+            vst_strncpy(text, (AntialiasValue == 0) ? " Off " : (AntialiasValue == 1) ? " 1st " : " 2nd ", kVstMaxParamStrLen);
+            break;
+            
         default :
             *text = '\0';
             break;
@@ -393,6 +544,21 @@ void Distortion::getParameterLabel(VstInt32 index, char *label)
             vst_strncpy(label, "    ", kVstMaxParamStrLen);
             break;
             
+        case kParamOversample:
+            // oversampling factor
+            vst_strncpy(label, " x ", kVstMaxParamStrLen);
+            break;
+            
+        case kParamPhase:
+            // oversampling filter phase
+            vst_strncpy(label, "    ", kVstMaxParamStrLen);
+            break;
+            
+        case kParamAntialias:
+            // antiderivative antialiasing
+            vst_strncpy(label, "    ", kVstMaxParamStrLen);
+            break;
+            
         default :
             *label = '\0';
             break;
@@ -434,73 +600,45 @@ void Distortion::processReplacing(float **inputs, float **outputs,
 // overwrite output
 {
     
-	float*	in0 = inputs[0];
-	float*  in1 = inputs[1];
-	float*	out0 = outputs[0];
-	float*  out1 = outputs[1];
-    
-	double isignal, fsignal, osignal, usignal, dsignal;
-    
-    double gain = 9.274340825277485e-11;
+	double isignal[kNumInputs], fsignal[kNumInputs], osignal;
+	float dsignals[kNumInputs];	// downsampled
     
-	int i, j, k;
+	int i, c;
     
 	for (i = 0; i < sampleFrames; i++)
 	{        
 		// assign input
-		double inp0 = (*in0);
-		double inp1 = (*in1);
-        
-		isignal = (inp0 + inp1)/2;
+		isignal[0] = inputs[0][i];
+		isignal[1] = inputs[1][i];
         
         
 		// apply input gain, input filter
-		// InFilter.process(drive*isignal, fsignal);
+		// InFilter[0].process(drive*isignal[0], fsignal[0]);
+		// InFilter[1].process(drive*isignal[1], fsignal[1]);
 		
         
-		// upsample, apply distortion, downsample
-		for (k = 0; k < kUSRatio; k++) {
-			// upsample (insert zeros) and apply upsampling gain
-			// usignal = (k == kUSRatio - 1) ? kUSRatio*fsignal : 0.0;
-            usignal = (k == kUSRatio - 1) ? kUSRatio*isignal : 0.0;
-            
-			// apply antiimaging filter
-			for (j = 0; j < kAAOrder; j++) {
-				AIFilter[j].process(usignal,usignal);
-			}
-            
-            usignal = gain*usignal;
-            
-			// apply distortion
+		// upsample (antiimaging filter), apply distortion, downsample
+		// (antialiasing filter); the filters take both channels at once
+		// Oversampler.upsample(fsignal[0], fsignal[1]);
+		Oversampler.upsample(isignal[0], isignal[1]);
+		for (c = 0; c < kNumInputs; c++) {
+			float* usignals = Oversampler.buffer[c];
+            
+			// apply distortion, to the frame's samples at the high rate
 			// note: x / (1+|x|) gives a soft saturation
 			// where as min(1, max(-1, x)) gives a hard clipping
-			// dsignal = usignal / (1.0 + fabs(usignal));
-            dsignal = fmin(1.0, fmax(-1.0, usignal));
-            
-			// apply antialiasing filter
-			for (j = 0; j < kAAOrder; j++) {
-				AAFilter[j].process(dsignal,dsignal);
-			}
-            
-            dsignal = gain*dsignal;
-            
+			Shaper[c].process(usignals, Oversampler.factor);	// hard clip
 		}
+		Oversampler.downsample(dsignals[0], dsignals[1]);
         
-        
-        
-        
-		// apply output gain, output filter
-		// OutFilter.process(level*dsignal, osignal);
-        
-        
-		// apply gain, assign output
-//		*out0++ = osignal;
-//		*out1++ = osignal;
-        *out0++ = level*dsignal;
-        *out1++ = level*dsignal;
-        
-		// update input pointers
-		in0++;in1++;
+		for (c = 0; c < kNumInputs; c++) {
+			// apply output gain, output filter
+			// OutFilter[c].process(level*dsignals[c], osignal);
+            
+			// apply gain, assign output
+			// outputs[c][i] = osignal;
+			outputs[c][i] = level*dsignals[c];
+		}
 	}
 }
 
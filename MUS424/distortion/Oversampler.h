@@ -0,0 +1,367 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : Oversampler.h
+// Created by   : music424 staff
+// Company      : CCRMA - Stanford University
+// Description  : Polyphase FIR oversampling around the Distortion's waveshaper.
+//                Going up, each input sample gives the factor outputs from the
+//                factor branches of the anti-imaging filter, so the zeros a
+//                zero-stuffing upsampler puts in between are never multiplied.
+//                Going down, the anti-aliasing filter runs only for the samples
+//                that are kept. The filters are linear phase, or minimum phase
+//                with the same magnitude response and next to no latency.
+//                Both channels go through together, each coefficient loaded
+//                once for the two of them.
+//                They are designed for the session's sample rate: flat to
+//                20 kHz (or 0.42 of the rate, below 47.6 kHz) and 80 dB down
+//                from where anything would alias back into that band, with
+//                only as many taps as the transition band needs.
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __Oversampler__
+#define __Oversampler__
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OS_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define OS_NEON 1
+#endif
+
+#ifndef M_PI
+#define M_PI                3.14159265358979323846
+#endif
+
+#define kMaxOversample      16
+#define kOSNumFactors       4           // 2x, 4x, 8x and 16x
+#define kOSTaps             32          // most taps per polyphase branch
+#define kOSMinTaps          8
+#define kOSMaxLength        (kOSTaps*kMaxOversample)
+#define kOSPassband         20000.0     // Hz, kept flat
+#define kOSMaxPassband      0.42        // fraction of the base rate, at low rates
+#define kOSAttenuation      80.0        // dB of stopband
+#define kOSKaiserBeta       7.86        // for kOSAttenuation
+
+
+//------------------------------------------------------------------------------
+struct PolyphaseOversampler {
+
+	// for each factor, linear then minimum phase
+	float   upCoefs[kOSNumFactors][2][kOSTaps*kMaxOversample];	// [branch][tap], branches padded to 4
+	float   downCoefs[kOSNumFactors][2][kOSMaxLength];		// time reversed
+	const float *up, *down;		// the ones in use
+	double  rate;		// base rate the designs are for, Hz
+	int     taps;		// per branch, at that rate
+
+	float   history[2][2*kOSTaps];	// input, written twice so the last taps are in order at pos
+	float   highHistory[2][2*kOSMaxLength];	// shaped signal, likewise
+	float   buffer[2][kMaxOversample];	// one input frame's worth at the high rate
+	int     factor, stride, length, pos, highPos;
+	bool    minimumPhase;
+
+	PolyphaseOversampler() {
+		rate = 0.0;
+		factor = 8;
+		minimumPhase = false;
+		setSampleRate(44100.0);
+	}
+
+	// designs for every factor and phase at base rate fs, unless those are the
+	// ones already made, as when the host sets the same rate again; then the
+	// current factor and phase, cleared. Not real-time safe.
+	void setSampleRate(double fs) {
+		if (fs != rate) {
+			rate = fs;
+			double pass = (kOSPassband < kOSMaxPassband*fs) ? kOSPassband : kOSMaxPassband*fs;
+			// Kaiser's estimate of the length, in base-rate samples, for a
+			// transition from pass to fs - pass
+			double estimate = (kOSAttenuation - 8.0)/(2.285*2.0*M_PI*(fs - 2.0*pass)/fs);
+			taps = 4*(int)ceil(estimate/4.0);
+			taps = (taps < kOSMinTaps) ? kOSMinTaps : (taps > kOSTaps) ? kOSTaps : taps;
+			for (int i = 0; i < kOSNumFactors; i++)
+				design(i);
+		}
+		select(factor, minimumPhase);
+	}
+
+	// factor (1, 2, 4, 8 or 16) and phase; clears the filters. Real-time safe,
+	// the designs are all made up front. At 1x the samples pass straight through.
+	void select(int f, bool minPhase) {
+		int i = 0;
+		while (i < kOSNumFactors-1 && (2 << i) < f)
+			i++;
+		factor = (f < 2) ? 1 : 2 << i;
+		stride = (factor < 4) ? 4 : factor;
+		length = taps*factor;
+		minimumPhase = minPhase;
+		up = upCoefs[i][minPhase ? 1 : 0];
+		down = downCoefs[i][minPhase ? 1 : 0];
+		reset();
+	}
+
+	void reset() {
+		memset(history, 0, sizeof(history));
+		memset(highHistory, 0, sizeof(highHistory));
+		memset(buffer, 0, sizeof(buffer));
+		pos = highPos = 0;
+	}
+
+	// samples of delay up and back down at factor f and the current rate: whole
+	// samples for linear phase, and none to speak of for minimum phase
+	long latencyFor(int f, bool minPhase) const {
+		return (f < 2 || minPhase) ? 0 : taps - 1;
+	}
+
+	// one frame in, factor frames out at the high rate, in buffer[0] and [1]
+	void upsample(float xL, float xR) {
+		if (factor == 1) {
+			buffer[0][0] = xL;
+			buffer[1][0] = xR;
+			return;
+		}
+		history[0][pos] = history[0][pos + taps] = xL;
+		history[1][pos] = history[1][pos + taps] = xR;
+		pos = (pos + 1 == taps) ? 0 : pos + 1;
+		const float* wL = history[0] + pos;
+		const float* wR = history[1] + pos;
+		int j = 0;
+#if defined(OS_SSE2)
+		// four branches at a time, their sums transposed into one vector
+		for (; j < stride; j += 4) {
+			const float* c = up + j*taps;
+			__m128 a0 = _mm_setzero_ps(), a1 = a0, a2 = a0, a3 = a0;
+			__m128 b0 = a0, b1 = a0, b2 = a0, b3 = a0;
+			for (int t = 0; t < taps; t += 4) {
+				__m128 xL4 = _mm_loadu_ps(wL + t), xR4 = _mm_loadu_ps(wR + t);
+				__m128 c0 = _mm_loadu_ps(c + t), c1 = _mm_loadu_ps(c + taps + t);
+				a0 = _mm_add_ps(a0, _mm_mul_ps(c0, xL4));
+				b0 = _mm_add_ps(b0, _mm_mul_ps(c0, xR4));
+				a1 = _mm_add_ps(a1, _mm_mul_ps(c1, xL4));
+				b1 = _mm_add_ps(b1, _mm_mul_ps(c1, xR4));
+				__m128 c2 = _mm_loadu_ps(c + 2*taps + t), c3 = _mm_loadu_ps(c + 3*taps + t);
+				a2 = _mm_add_ps(a2, _mm_mul_ps(c2, xL4));
+				b2 = _mm_add_ps(b2, _mm_mul_ps(c2, xR4));
+				a3 = _mm_add_ps(a3, _mm_mul_ps(c3, xL4));
+				b3 = _mm_add_ps(b3, _mm_mul_ps(c3, xR4));
+			}
+			__m128 s01 = _mm_add_ps(_mm_unpacklo_ps(a0, a1), _mm_unpackhi_ps(a0, a1));
+			__m128 s23 = _mm_add_ps(_mm_unpacklo_ps(a2, a3), _mm_unpackhi_ps(a2, a3));
+			_mm_storeu_ps(buffer[0] + j, _mm_add_ps(_mm_movelh_ps(s01, s23), _mm_movehl_ps(s23, s01)));
+			s01 = _mm_add_ps(_mm_unpacklo_ps(b0, b1), _mm_unpackhi_ps(b0, b1));
+			s23 = _mm_add_ps(_mm_unpacklo_ps(b2, b3), _mm_unpackhi_ps(b2, b3));
+			_mm_storeu_ps(buffer[1] + j, _mm_add_ps(_mm_movelh_ps(s01, s23), _mm_movehl_ps(s23, s01)));
+		}
+#elif defined(OS_NEON)
+		for (; j < stride; j += 4) {
+			const float* c = up + j*taps;
+			float32x4_t a0 = vdupq_n_f32(0.0f), a1 = a0, a2 = a0, a3 = a0;
+			float32x4_t b0 = a0, b1 = a0, b2 = a0, b3 = a0;
+			for (int t = 0; t < taps; t += 4) {
+				float32x4_t xL4 = vld1q_f32(wL + t), xR4 = vld1q_f32(wR + t);
+				float32x4_t c0 = vld1q_f32(c + t), c1 = vld1q_f32(c + taps + t);
+				float32x4_t c2 = vld1q_f32(c + 2*taps + t), c3 = vld1q_f32(c + 3*taps + t);
+				a0 = vmlaq_f32(a0, c0, xL4);
+				b0 = vmlaq_f32(b0, c0, xR4);
+				a1 = vmlaq_f32(a1, c1, xL4);
+				b1 = vmlaq_f32(b1, c1, xR4);
+				a2 = vmlaq_f32(a2, c2, xL4);
+				b2 = vmlaq_f32(b2, c2, xR4);
+				a3 = vmlaq_f32(a3, c3, xL4);
+				b3 = vmlaq_f32(b3, c3, xR4);
+			}
+			vst1q_f32(buffer[0] + j, vpaddq_f32(vpaddq_f32(a0, a1), vpaddq_f32(a2, a3)));
+			vst1q_f32(buffer[1] + j, vpaddq_f32(vpaddq_f32(b0, b1), vpaddq_f32(b2, b3)));
+		}
+#endif
+		for (; j < factor; j++) {
+			float accL = 0.0f, accR = 0.0f;
+			for (int t = 0; t < taps; t++) {
+				accL += up[j*taps + t]*wL[t];
+				accR += up[j*taps + t]*wR[t];
+			}
+			buffer[0][j] = accL;
+			buffer[1][j] = accR;
+		}
+	}
+
+	// factor frames at the high rate in, from buffer[0] and [1], one frame out
+	void downsample(float& yL, float& yR) {
+		if (factor == 1) {
+			yL = buffer[0][0];
+			yR = buffer[1][0];
+			return;
+		}
+		for (int k = 0; k < factor; k++) {
+			highHistory[0][highPos] = highHistory[0][highPos + length] = buffer[0][k];
+			highHistory[1][highPos] = highHistory[1][highPos + length] = buffer[1][k];
+			highPos = (highPos + 1 == length) ? 0 : highPos + 1;
+		}
+		const float* wL = highHistory[0] + highPos;
+		const float* wR = highHistory[1] + highPos;
+		int i = 0;
+		yL = yR = 0.0f;
+#if defined(OS_SSE2)
+		__m128 a0 = _mm_setzero_ps(), a1 = a0, a2 = a0, a3 = a0;
+		__m128 b0 = a0, b1 = a0, b2 = a0, b3 = a0;
+		for (; i + 16 <= length; i += 16) {
+			__m128 d0 = _mm_loadu_ps(down + i), d1 = _mm_loadu_ps(down + i + 4);
+			a0 = _mm_add_ps(a0, _mm_mul_ps(d0, _mm_loadu_ps(wL + i)));
+			b0 = _mm_add_ps(b0, _mm_mul_ps(d0, _mm_loadu_ps(wR + i)));
+			a1 = _mm_add_ps(a1, _mm_mul_ps(d1, _mm_loadu_ps(wL + i + 4)));
+			b1 = _mm_add_ps(b1, _mm_mul_ps(d1, _mm_loadu_ps(wR + i + 4)));
+			__m128 d2 = _mm_loadu_ps(down + i + 8), d3 = _mm_loadu_ps(down + i + 12);
+			a2 = _mm_add_ps(a2, _mm_mul_ps(d2, _mm_loadu_ps(wL + i + 8)));
+			b2 = _mm_add_ps(b2, _mm_mul_ps(d2, _mm_loadu_ps(wR + i + 8)));
+			a3 = _mm_add_ps(a3, _mm_mul_ps(d3, _mm_loadu_ps(wL + i + 12)));
+			b3 = _mm_add_ps(b3, _mm_mul_ps(d3, _mm_loadu_ps(wR + i + 12)));
+		}
+		// both sums at once, L in the low lanes and R in the high
+		a0 = _mm_add_ps(_mm_add_ps(a0, a1), _mm_add_ps(a2, a3));
+		b0 = _mm_add_ps(_mm_add_ps(b0, b1), _mm_add_ps(b2, b3));
+		__m128 s = _mm_add_ps(_mm_movelh_ps(a0, b0), _mm_movehl_ps(b0, a0));
+		s = _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 3, 0, 1)));
+		yL = _mm_cvtss_f32(s);
+		yR = _mm_cvtss_f32(_mm_movehl_ps(s, s));
+#elif defined(OS_NEON)
+		float32x4_t a0 = vdupq_n_f32(0.0f), a1 = a0, a2 = a0, a3 = a0;
+		float32x4_t b0 = a0, b1 = a0, b2 = a0, b3 = a0;
+		for (; i + 16 <= length; i += 16) {
+			float32x4_t d0 = vld1q_f32(down + i), d1 = vld1q_f32(down + i + 4);
+			float32x4_t d2 = vld1q_f32(down + i + 8), d3 = vld1q_f32(down + i + 12);
+			a0 = vmlaq_f32(a0, d0, vld1q_f32(wL + i));
+			b0 = vmlaq_f32(b0, d0, vld1q_f32(wR + i));
+			a1 = vmlaq_f32(a1, d1, vld1q_f32(wL + i + 4));
+			b1 = vmlaq_f32(b1, d1, vld1q_f32(wR + i + 4));
+			a2 = vmlaq_f32(a2, d2, vld1q_f32(wL + i + 8));
+			b2 = vmlaq_f32(b2, d2, vld1q_f32(wR + i + 8));
+			a3 = vmlaq_f32(a3, d3, vld1q_f32(wL + i + 12));
+			b3 = vmlaq_f32(b3, d3, vld1q_f32(wR + i + 12));
+		}
+		yL = vaddvq_f32(vaddq_f32(vaddq_f32(a0, a1), vaddq_f32(a2, a3)));
+		yR = vaddvq_f32(vaddq_f32(vaddq_f32(b0, b1), vaddq_f32(b2, b3)));
+#endif
+		for (; i < length; i++) {
+			yL += down[i]*wL[i];
+			yR += down[i]*wR[i];
+		}
+	}
+
+protected:
+	// Kaiser-windowed sinc lowpass for factor 2 << i, taps*factor taps with
+	// its half-amplitude point at the base rate's Nyquist, unity gain at DC,
+	// and its minimum-phase version. The upsampler's branches are the taps
+	// p, p + factor, ..., scaled by factor so each passes DC at unity.
+	void design(int i) {
+		int L = 2 << i, n = taps*L, s = (L < 4) ? 4 : L;
+		double h[kOSMaxLength];
+		double fc = 0.5/L, centre = 0.5*(n - 1), total = 0.0;
+		for (int k = 0; k < n; k++) {
+			double d = k - centre, r = d/centre;
+			double sinc = (d == 0.0) ? 1.0 : sin(2.0*M_PI*fc*d)/(2.0*M_PI*fc*d);
+			h[k] = sinc*besselI0(kOSKaiserBeta*sqrt((r*r < 1.0) ? 1.0 - r*r : 0.0));
+			total += h[k];
+		}
+		for (int k = 0; k < n; k++)
+			h[k] /= total;
+		for (int ph = 0; ph < 2; ph++) {
+			if (ph == 1)
+				makeMinimumPhase(h, n);
+			for (int p = 0; p < s; p++)
+				for (int t = 0; t < taps; t++)
+					upCoefs[i][ph][p*taps + t] = (p < L) ? (float)(L*h[(taps-1-t)*L + p]) : 0.0f;
+			for (int k = 0; k < n; k++)
+				downCoefs[i][ph][k] = (float)h[n-1-k];
+		}
+	}
+
+	// the minimum-phase filter with h's magnitude response, by folding the
+	// real cepstrum; rescaled to unity gain at DC. Not real-time safe.
+	static void makeMinimumPhase(double* h, int n) {
+		int m = 1, k;
+		while (m < 8*n)
+			m <<= 1;
+		double* re = new double[m];
+		double* im = new double[m];
+		for (k = 0; k < m; k++) {
+			re[k] = (k < n) ? h[k] : 0.0;
+			im[k] = 0.0;
+		}
+		fft(re, im, m, false);
+		for (k = 0; k < m; k++) {
+			double mag = sqrt(re[k]*re[k] + im[k]*im[k]);
+			re[k] = log((mag > 1e-9) ? mag : 1e-9);		// the stopband zeros, floored
+			im[k] = 0.0;
+		}
+		fft(re, im, m, true);
+		for (k = 1; k < m; k++) {
+			re[k] = (k < m/2) ? 2.0*re[k] : (k == m/2) ? re[k] : 0.0;
+			im[k] = 0.0;
+		}
+		fft(re, im, m, false);
+		for (k = 0; k < m; k++) {
+			double mag = exp(re[k]);
+			re[k] = mag*cos(im[k]);
+			im[k] = mag*sin(im[k]);
+		}
+		fft(re, im, m, true);
+		double total = 0.0;
+		for (k = 0; k < n; k++)
+			total += re[k];
+		for (k = 0; k < n; k++)
+			h[k] = re[k]/total;
+		delete[] re;
+		delete[] im;
+	}
+
+	// in-place radix-2 complex FFT of n points, n a power of two; the inverse
+	// is scaled by 1/n
+	static void fft(double* re, double* im, int n, bool inverse) {
+		int i, j, k;
+		for (i = 1, j = 0; i < n; i++) {
+			int bit = n >> 1;
+			for (; j & bit; bit >>= 1)
+				j ^= bit;
+			j ^= bit;
+			if (i < j) {
+				double t = re[i]; re[i] = re[j]; re[j] = t;
+				t = im[i]; im[i] = im[j]; im[j] = t;
+			}
+		}
+		for (int len = 2; len <= n; len <<= 1) {
+			double a = (inverse ? 2.0 : -2.0)*M_PI/len;
+			for (k = 0; k < len/2; k++) {
+				double wr = cos(a*k), wi = sin(a*k);
+				for (i = k; i < n; i += len) {
+					int q = i + len/2;
+					double xr = re[q]*wr - im[q]*wi, xi = re[q]*wi + im[q]*wr;
+					re[q] = re[i] - xr; im[q] = im[i] - xi;
+					re[i] += xr; im[i] += xi;
+				}
+			}
+		}
+		if (inverse)
+			for (k = 0; k < n; k++) {
+				re[k] /= n;
+				im[k] /= n;
+			}
+	}
+
+	// modified Bessel function of the first kind, order 0, from its series
+	static double besselI0(double x) {
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; k++) {
+			term *= (0.5*x/k)*(0.5*x/k);
+			sum += term;
+		}
+		return sum;
+	}
+};
+
+
+#endif	// __Oversampler__
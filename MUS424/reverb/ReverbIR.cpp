@@ -0,0 +1,593 @@
+//------------------------------------------------------------------------------
+// Command-line tool
+//
+// Filename     : ReverbIR.cpp
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  : Renders the Reverb's impulse response without a host and
+//              measures it: energy decay curves and T60 per octave band,
+//              echo density, and what the render cost in ns/sample. Meant
+//              for tuning the FDN tables and shelves from a script.
+//
+//              g++ -O2 -D__cdecl= -I../../ReverbVST/vst_sdk
+//                  -I../../ReverbVST/vst_sdk/pluginterfaces/vst2.x
+//                  ReverbIR.cpp ReverbSolution.cpp
+//                  ../../ReverbVST/vst_sdk/public.sdk/source/vst2.x/audioeffect.cpp
+//                  ../../ReverbVST/vst_sdk/public.sdk/source/vst2.x/audioeffectx.cpp
+//                  -o ReverbIR
+//
+//              ReverbIR [options]
+//                -r rate       sample rate, Hz (44100)
+//                -s seconds    length of the render (1.5 x the longest T60 + 0.5)
+//                -b frames     host block size (256)
+//                -n passes     renders to time, the fastest is reported (3)
+//                -p index=knob any parameter, knob on [0,1]
+//                -low s, -high s, -transition Hz
+//                              the shelf settings in their own units
+//                -mod s        delay modulation depth, 0 for static lines (0)
+//                -modrate Hz   delay modulation rate
+//                -budget x     most the modulated render may cost, re the
+//                              static one (2)
+//                -room m       room size for the early reflections
+//                -outputs n    output channels, 6 is laid out as 5.1 (2)
+//                -freeze s     switch freeze on this far into the render
+//                -storage type float or double delay lines (float)
+//                -silent s     time an impulse and s seconds of silence
+//                              instead, see below
+//                -o prefix     output files (reverb_ir, ignored by git)
+//                -w file.wav   also write the impulse response
+//
+//              Writes prefix_edc.csv (EDC in dB per band, 1 ms steps),
+//              prefix_t60.csv (measured and designed T60 per band) and
+//              prefix_density.csv (normalized echo density, 10 ms steps).
+//              The summary goes to stdout as "name: value" lines. With
+//              modulation on, the static version is timed as well, and the
+//              exit status is 1 if the ratio is over the budget. With
+//              more than two outputs the energies of all of them are
+//              summed, and the largest correlation between any two
+//              (non-LFE) channels is reported too. With -freeze, the level
+//              of the last second re the first second after the freeze
+//              has settled is reported as the freeze drift.
+//
+//              With -silent, nothing is measured but the cost of the silent
+//              tail: the T60s default to 0.1 s, the idle bypass is held off
+//              so the network keeps running all the way down, and the render
+//              is timed with flush-to-zero on and off. The mean and the
+//              slowest second, in ns/sample, are reported for both. Float
+//              lines only go denormal as they are stored; double lines get
+//              there after about 10 s (-storage double -silent 14).
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#include "ReverbSolution.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define kNumBands		8				// octave bands from 63 Hz to 8 kHz
+#define kFirstBand		62.5
+#define kEDCStep		0.001			// seconds between EDC rows
+#define kDensityWindow	0.020			// echo density window and hop, seconds
+#define kDensityHop		0.010
+#define kParamFreeze	7				// Reverb's freeze parameter
+#define kSilentT60		0.1				// default T60s for the silent tail, seconds
+#define kModBudget		2.0				// modulated render's cost re the static one, at most
+
+
+//------------------------------------------------------------------------------
+// The Reverb with its idle bypass held off, so a silent tail keeps running the
+// network all the way down into the denormal range, and with flush-to-zero
+// under the tool's control.
+class AwakeReverb : public Reverb
+{
+public:
+	AwakeReverb () : Reverb(0) {}
+
+	void setFlush (bool on)		{	flushDenormals = on;	}
+
+	virtual void processReplacing (float** inputs, float** outputs, VstInt32 sampleFrames)
+	{
+		quietFrames = 0;								// never gets past settleFrames()
+		Reverb::processReplacing(inputs, outputs, sampleFrames);
+	}
+};
+
+
+//------------------------------------------------------------------------------
+// Butterworth sections for the octave band filters (RBJ cookbook, Q = 1/sqrt(2))
+static void butterworth(double* c, double fc, double fs, bool highpass)
+{
+	double w = 2*M_PI*fc/fs, alpha = sin(w)/sqrt(2.0), cw = cos(w);
+	double a0 = 1 + alpha;
+	double g = highpass ? (1 + cw)/2 : (1 - cw)/2;
+	c[0] = g/a0;
+	c[1] = (highpass ? -2*g : 2*g)/a0;
+	c[2] = g/a0;
+	c[3] = -2*cw/a0;
+	c[4] = (1 - alpha)/a0;
+}
+
+// octave band around fc: two highpass and two lowpass sections at the edges
+static void octaveBand(const double* x, double* y, long n, double fc, double fs)
+{
+	Biquad f[4];
+	double c[5];
+	butterworth(c, fc/sqrt(2.0), fs, true);
+	f[0].setCoefs(c); f[1].setCoefs(c);
+	butterworth(c, fc*sqrt(2.0), fs, false);
+	f[2].setCoefs(c); f[3].setCoefs(c);
+	for (long i=0; i<n; i++) {
+		double v = x[i];
+		for (int k=0; k<4; k++)
+			f[k].process(v, v);
+		y[i] = v;
+	}
+}
+
+// Schroeder backward integration, in dB re the total energy
+static void energyDecay(const double* e, double* edc, long n)
+{
+	double sum = 0.0;
+	for (long i=n-1; i>=0; i--) {
+		sum += e[i];
+		edc[i] = sum;
+	}
+	double total = edc[0] > 0.0 ? edc[0] : 1.0;
+	for (long i=0; i<n; i++)
+		edc[i] = 10.0*log10(edc[i]/total + 1e-30);
+}
+
+// T60 from a line fit to the EDC between -5 dB and -35 dB (T30), or -25 dB
+// (T20) if the EDC never gets to -35 dB. Returns 0 if neither range is there.
+static double fitT60(const double* edc, long n, double fs, const char** method)
+{
+	double top = -5.0, bottom = -35.0;
+	*method = "T30";
+	if (edc[n-1] > bottom) {
+		bottom = -25.0;
+		*method = "T20";
+		if (edc[n-1] > bottom) {
+			*method = "none";
+			return 0.0;
+		}
+	}
+	double st = 0, sy = 0, stt = 0, sty = 0;
+	long count = 0;
+	for (long i=0; i<n; i++) {
+		if (edc[i] > top)
+			continue;
+		if (edc[i] < bottom)
+			break;
+		double t = i/fs;
+		st += t; sy += edc[i]; stt += t*t; sty += t*edc[i];
+		count++;
+	}
+	if (count < 2)
+		return 0.0;
+	double slope = (count*sty - st*sy)/(count*stt - st*st);		// dB per second
+	return slope < 0.0 ? -60.0/slope : 0.0;
+}
+
+// normalized echo density (Abel and Huang): the fraction of samples in a
+// window that lie more than one standard deviation out, over the fraction a
+// Gaussian would have there. Reaches 1 once the tail is noise-like.
+static double echoDensity(const double* x, long start, long len)
+{
+	double sw = 0, sxx = 0;
+	for (long i=0; i<len; i++) {
+		double w = 0.5 - 0.5*cos(2*M_PI*(i + 0.5)/len);
+		sw += w; sxx += w*x[start+i]*x[start+i];
+	}
+	double sd = sqrt(sxx/sw), out = 0;
+	for (long i=0; i<len; i++) {
+		double w = 0.5 - 0.5*cos(2*M_PI*(i + 0.5)/len);
+		if (fabs(x[start+i]) > sd)
+			out += w;
+	}
+	return out/sw/erfc(1.0/sqrt(2.0));
+}
+
+static void put16(FILE* f, unsigned v)	{	fputc(v & 255, f); fputc((v >> 8) & 255, f);	}
+static void put32(FILE* f, unsigned v)	{	put16(f, v & 65535); put16(f, v >> 16);	}
+
+// 32-bit float WAV of channels interleaved outputs
+static bool writeWave(const char* path, float* const* x, int channels, long n, double fs)
+{
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+	unsigned frame = 4*channels;
+	fwrite("RIFF", 1, 4, f); put32(f, 36 + frame*n); fwrite("WAVE", 1, 4, f);
+	fwrite("fmt ", 1, 4, f); put32(f, 16); put16(f, 3); put16(f, channels);
+	put32(f, (unsigned)fs); put32(f, (unsigned)fs*frame); put16(f, frame); put16(f, 32);
+	fwrite("data", 1, 4, f); put32(f, frame*n);
+	for (long i=0; i<n; i++)
+		for (int c=0; c<channels; c++)
+			fwrite(x[c]+i, 4, 1, f);					// little-endian hosts only
+	fclose(f);
+	return true;
+}
+
+// what a host would hand setSpeakerArrangement(): stereo in, channels out
+static VstSpeakerArrangement* outputArrangement(int channels)
+{
+	static const int k51[6] = {kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLfe, kSpeakerLs, kSpeakerRs};
+	size_t extra = channels > 8 ? (channels - 8)*sizeof(VstSpeakerProperties) : 0;
+	VstSpeakerArrangement* arr = (VstSpeakerArrangement*)calloc(1, sizeof(VstSpeakerArrangement) + extra);
+	arr->numChannels = channels;
+	arr->type = (channels == 6) ? kSpeakerArr51 : (channels == 2) ? kSpeakerArrStereo
+				: (channels == 1) ? kSpeakerArrMono : kSpeakerArrUserDefined;
+	for (int c=0; c<channels; c++)
+		arr->speakers[c].type = (channels == 6) ? k51[c] : (channels == 1) ? kSpeakerM : kSpeakerUndefined;
+	if (channels == 2) {
+		arr->speakers[0].type = kSpeakerL;
+		arr->speakers[1].type = kSpeakerR;
+	}
+	return arr;
+}
+
+// render n frames of impulse response from the left input into channels
+// outputs, passes times, freezing at frame freezeAt if that is not negative;
+// returns the fastest pass's time spent in processReplacing, seconds
+static double render(Reverb* rv, float** out, int channels, long n, int block, int passes, long freezeAt)
+{
+	float* in[2] = {new float[block], new float[block]};
+	float* blk[kMaxFDNOutputs];
+	double best = 0.0;
+	for (int p=0; p<passes; p++) {
+		rv->setParameter(kParamFreeze, 0.0f);
+		rv->resume();
+		double cost = 0.0;
+		for (long i=0; i<n; i+=block) {
+			int frames = (int)min((long)block, n - i);
+			memset(in[0], 0, frames*sizeof(float));
+			memset(in[1], 0, frames*sizeof(float));
+			if (i == 0)
+				in[0][0] = 1.0f;
+			if (freezeAt >= 0 && i <= freezeAt && freezeAt < i + frames)
+				rv->setParameter(kParamFreeze, 1.0f);		// takes effect at the next block
+			for (int c=0; c<channels; c++)
+				blk[c] = out[c] + i;
+			clock_t t0 = clock();
+			rv->processReplacing(in, blk, frames);
+			cost += (double)(clock() - t0)/CLOCKS_PER_SEC;
+		}
+		if (p == 0 || cost < best)
+			best = cost;
+	}
+	delete[] in[0]; delete[] in[1];
+	return best;
+}
+
+// an impulse and then silence, n frames, passes times; each second of audio
+// keeps its fastest pass. Returns the mean and the slowest second, ns/sample.
+static void silentTail(Reverb* rv, float** out, int channels, long n, int block, int passes,
+					   double fs, double& mean, double& worst)
+{
+	long second = (long)fs, numSeconds = (n + second - 1)/second;
+	double* cost = new double[numSeconds];
+	float* in[2] = {new float[block], new float[block]};
+	float* blk[kMaxFDNOutputs];
+	for (int p=0; p<passes; p++) {
+		double* pass = new double[numSeconds];
+		memset(pass, 0, numSeconds*sizeof(double));
+		rv->resume();
+		for (long i=0; i<n; i+=block) {
+			int frames = (int)min((long)block, n - i);
+			memset(in[0], 0, frames*sizeof(float));
+			memset(in[1], 0, frames*sizeof(float));
+			if (i == 0)
+				in[0][0] = 1.0f;
+			for (int c=0; c<channels; c++)
+				blk[c] = out[c] + i;
+			clock_t t0 = clock();
+			rv->processReplacing(in, blk, frames);
+			pass[i/second] += (double)(clock() - t0)/CLOCKS_PER_SEC;
+		}
+		for (long s=0; s<numSeconds; s++)
+			if (p == 0 || pass[s] < cost[s])
+				cost[s] = pass[s];
+		delete[] pass;
+	}
+	mean = worst = 0.0;
+	for (long s=0; s<numSeconds; s++) {
+		long frames = min(second, n - s*second);
+		mean += cost[s];
+		worst = max(worst, cost[s]*1e9/frames);
+	}
+	mean *= 1e9/n;
+	delete[] cost;
+	delete[] in[0]; delete[] in[1];
+}
+
+static FILE* openCSV(const char* prefix, const char* name)
+{
+	char path[1024];
+	snprintf(path, sizeof(path), "%s_%s.csv", prefix, name);
+	FILE* f = fopen(path, "w");
+	if (!f)
+		fprintf(stderr, "ReverbIR: can't write %s\n", path);
+	return f;
+}
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	double fs = 44100.0, seconds = 0.0;
+	int block = 256, passes = 3;
+	const char* prefix = "reverb_ir";
+	const char* wavePath = 0;
+	double low = 0.0, high = 0.0, transition = 0.0;
+	double modDepth = -1.0, modRate = 0.0, room = 0.0, budget = kModBudget;
+	int numKnobs = 0, knobIndex[16];
+	int channels = 2;
+	double freeze = -1.0, silent = 0.0;
+	int storage = kFDNStorage;
+	float knobValue[16];
+
+	for (int a=1; a<argc; a++) {
+		const char* opt = argv[a];
+		const char* arg = (a+1 < argc) ? argv[a+1] : 0;
+		if (!arg) {
+			fprintf(stderr, "ReverbIR: %s needs a value (see the top of ReverbIR.cpp)\n", opt);
+			return 1;
+		}
+		a++;
+		if (!strcmp(opt, "-r"))					fs = atof(arg);
+		else if (!strcmp(opt, "-s"))			seconds = atof(arg);
+		else if (!strcmp(opt, "-b"))			block = atoi(arg);
+		else if (!strcmp(opt, "-n"))			passes = atoi(arg);
+		else if (!strcmp(opt, "-o"))			prefix = arg;
+		else if (!strcmp(opt, "-w"))			wavePath = arg;
+		else if (!strcmp(opt, "-low"))			low = atof(arg);
+		else if (!strcmp(opt, "-high"))			high = atof(arg);
+		else if (!strcmp(opt, "-transition"))	transition = atof(arg);
+		else if (!strcmp(opt, "-mod"))			modDepth = atof(arg);
+		else if (!strcmp(opt, "-modrate"))		modRate = atof(arg);
+		else if (!strcmp(opt, "-budget"))		budget = atof(arg);
+		else if (!strcmp(opt, "-room"))			room = atof(arg);
+		else if (!strcmp(opt, "-outputs"))		channels = atoi(arg);
+		else if (!strcmp(opt, "-freeze"))		freeze = atof(arg);
+		else if (!strcmp(opt, "-silent"))		silent = atof(arg);
+		else if (!strcmp(opt, "-storage"))		storage = strcmp(arg, "double") ? kFDNStoreFloat : kFDNStoreDouble;
+		else if (!strcmp(opt, "-p") && numKnobs < 16 && strchr(arg, '=')) {
+			knobIndex[numKnobs] = atoi(arg);
+			knobValue[numKnobs++] = atof(strchr(arg, '=') + 1);
+		} else {
+			fprintf(stderr, "ReverbIR: unknown option %s %s\n", opt, arg);
+			return 1;
+		}
+	}
+	if (fs < 8000.0 || block < 1 || passes < 1 || channels < 1 || channels > kMaxFDNOutputs) {
+		fprintf(stderr, "ReverbIR: bad rate, block size, pass or channel count\n");
+		return 1;
+	}
+
+	// no host: audioMaster is 0, so the rate has to be pushed in by hand
+	Reverb* rv = (silent > 0.0) ? new AwakeReverb() : new Reverb(0);
+	rv->setSampleRate(fs);
+	rv->setStorage(storage);
+	VstSpeakerArrangement* inArr = outputArrangement(2);
+	VstSpeakerArrangement* outArr = outputArrangement(channels);
+	if (!rv->setSpeakerArrangement(inArr, outArr)) {
+		fprintf(stderr, "ReverbIR: %d outputs refused\n", channels);
+		return 1;
+	}
+	if (modDepth < 0.0)
+		modDepth = kFDNModDepth;
+	if (modRate <= 0.0)
+		modRate = kFDNModRate;
+	rv->setModulation(modDepth, modRate);
+	if (room > 0.0)
+		rv->setRoomSize(room);
+	for (int k=0; k<numKnobs; k++)
+		rv->setParameter(knobIndex[k], knobValue[k]);
+	if (silent > 0.0) {
+		low = (low > 0.0) ? low : kSilentT60;
+		high = (high > 0.0) ? high : kSilentT60;
+	}
+	if (low > 0.0)
+		rv->setParameter(0, SmartKnob::value2knob(low, T60LowLimits, T60LowTaper));
+	if (high > 0.0)
+		rv->setParameter(1, SmartKnob::value2knob(high, T60HighLimits, T60HighTaper));
+	if (transition > 0.0)
+		rv->setParameter(2, SmartKnob::value2knob(transition, TransitionLimits, TransitionTaper));
+	rv->setParameter(3, 1.0);							// wet only: no direct impulse in the IR
+
+	// silent tail: the same render with and without flush-to-zero
+	if (silent > 0.0) {
+		long n = (long)(silent*fs);
+		float* out[kMaxFDNOutputs];
+		for (int c=0; c<channels; c++)
+			out[c] = new float[n];
+		double mean[2], worst[2];
+		for (int f=0; f<2; f++) {
+			((AwakeReverb*)rv)->setFlush(f == 0);
+			silentTail(rv, out, channels, n, block, passes, fs, mean[f], worst[f]);
+		}
+		printf("rate: %g\n", fs);
+		printf("seconds: %g\n", silent);
+		printf("block: %d\n", block);
+		printf("storage: %s\n", (storage == kFDNStoreDouble) ? "double" : "float");
+		printf("silent_ns_per_sample_ftz: %.2f\n", mean[0]);
+		printf("silent_ns_per_sample_no_ftz: %.2f\n", mean[1]);
+		printf("silent_worst_second_ftz: %.2f\n", worst[0]);
+		printf("silent_worst_second_no_ftz: %.2f\n", worst[1]);
+		for (int c=0; c<channels; c++)
+			delete[] out[c];
+		delete rv;
+		free(inArr); free(outArr);
+		return 0;
+	}
+
+	double t60low = SmartKnob::knob2value(rv->getParameter(0), T60LowLimits, T60LowTaper);
+	double t60high = SmartKnob::knob2value(rv->getParameter(1), T60HighLimits, T60HighTaper);
+	if (seconds <= 0.0)
+		seconds = 1.5*max(t60low, t60high) + 0.5;
+	long n = (long)(seconds*fs);
+
+	float* out[kMaxFDNOutputs];
+	for (int c=0; c<channels; c++)
+		out[c] = new float[n];
+	long freezeAt = (freeze >= 0.0) ? (long)(freeze*fs) : -1;
+	double best = render(rv, out, channels, n, block, passes, freezeAt);
+
+	// the same render with static delay lines, as the yardstick for what
+	// the modulation costs
+	double staticBest = 0.0;
+	if (modDepth > 0.0) {
+		float* scratch[kMaxFDNOutputs];
+		for (int c=0; c<channels; c++)
+			scratch[c] = new float[n];
+		rv->setModulation(0.0, modRate);
+		staticBest = render(rv, scratch, channels, n, block, passes, freezeAt);
+		rv->setModulation(modDepth, modRate);
+		for (int c=0; c<channels; c++)
+			delete[] scratch[c];
+	}
+
+	// analysis on the sum of the outputs' energies
+	double* x[kMaxFDNOutputs];
+	double* e = new double[n];
+	double* edc[kNumBands + 1];
+	double* band = new double[n];
+	for (int c=0; c<channels; c++) {
+		x[c] = new double[n];
+		for (long i=0; i<n; i++)
+			x[c][i] = out[c][i];
+	}
+	int numBands = 0;
+	double centers[kNumBands + 1];
+	centers[0] = 0.0;									// broadband
+	for (int b=0; b<=kNumBands; b++) {
+		double fc = (b == 0) ? 0.0 : kFirstBand*(1 << (b-1));
+		if (b > 0 && fc*sqrt(2.0) > 0.45*fs)
+			break;										// band runs into Nyquist
+		for (long i=0; i<n; i++)
+			e[i] = 0.0;
+		for (int c=0; c<channels; c++) {
+			if (b == 0)
+				memcpy(band, x[c], n*sizeof(double));
+			else
+				octaveBand(x[c], band, n, fc, fs);
+			for (long i=0; i<n; i++)
+				e[i] += band[i]*band[i];
+		}
+		edc[b] = new double[n];
+		energyDecay(e, edc[b], n);
+		centers[b] = fc;
+		numBands = b + 1;
+	}
+
+	FILE* f = openCSV(prefix, "edc");
+	if (!f)
+		return 1;
+	fprintf(f, "time");
+	for (int b=0; b<numBands; b++)
+		b ? fprintf(f, ",%g", centers[b]) : fprintf(f, ",broadband");
+	fprintf(f, "\n");
+	long step = max(1L, (long)(kEDCStep*fs + 0.5));
+	for (long i=0; i<n; i+=step) {
+		fprintf(f, "%.4f", i/fs);
+		for (int b=0; b<numBands; b++)
+			fprintf(f, ",%.3f", edc[b][i]);
+		fprintf(f, "\n");
+	}
+	fclose(f);
+
+	double broadT60 = 0.0;
+	f = openCSV(prefix, "t60");
+	if (!f)
+		return 1;
+	fprintf(f, "band,t60,method,design\n");
+	for (int b=0; b<numBands; b++) {
+		const char* method;
+		double t60 = fitT60(edc[b], n, fs, &method);
+		if (b == 0) {
+			broadT60 = t60;
+			fprintf(f, "broadband,%.4f,%s,\n", t60, method);
+		} else {
+			fprintf(f, "%g,%.4f,%s,%.4f\n", centers[b], t60, method, rv->shelfT60(centers[b]));
+		}
+	}
+	fclose(f);
+
+	// echo density of the left output; mixing time is where it first reaches 1
+	f = openCSV(prefix, "density");
+	if (!f)
+		return 1;
+	fprintf(f, "time,density\n");
+	long win = (long)(kDensityWindow*fs), hop = (long)(kDensityHop*fs);
+	double mixing = -1.0;
+	for (long i=0; i+win<=n; i+=hop) {
+		double d = echoDensity(x[0], i, win);
+		double t = (i + win/2)/fs;
+		if (mixing < 0.0 && d >= 1.0)
+			mixing = t;
+		fprintf(f, "%.4f,%.4f\n", t, d);
+	}
+	fclose(f);
+
+	// zero-lag correlation between every pair of channels that have a tail
+	double maxCorr = 0.0;
+	for (int c=0; c<channels; c++)
+		for (int d=c+1; d<channels; d++) {
+			double scd = 0, scc = 0, sdd = 0;
+			for (long i=0; i<n; i++) {
+				scd += x[c][i]*x[d][i]; scc += x[c][i]*x[c][i]; sdd += x[d][i]*x[d][i];
+			}
+			if (scc > 0.0 && sdd > 0.0)
+				maxCorr = max(maxCorr, fabs(scd)/sqrt(scc*sdd));
+		}
+
+	// output level a second after the freeze has settled, and at the end
+	double drift = 0.0;
+	long settled = freezeAt + (long)((kFreezeTime + 1.0)*fs), second = (long)fs;
+	if (freezeAt >= 0 && settled + 2*second <= n) {
+		double first = 0.0, last = 0.0;
+		for (int c=0; c<channels; c++)
+			for (long i=0; i<second; i++) {
+				first += x[c][settled + i]*x[c][settled + i];
+				last += x[c][n - second + i]*x[c][n - second + i];
+			}
+		drift = (first > 0.0 && last > 0.0) ? 10.0*log10(last/first) : 0.0;
+	}
+
+	if (wavePath && !writeWave(wavePath, out, channels, n, fs))
+		fprintf(stderr, "ReverbIR: can't write %s\n", wavePath);
+
+	printf("rate: %g\n", fs);
+	printf("seconds: %g\n", seconds);
+	printf("block: %d\n", block);
+	printf("t60_low_design: %g\n", t60low);
+	printf("t60_high_design: %g\n", t60high);
+	printf("t60_broadband: %.4f\n", broadT60);
+	printf("mixing_time: %.4f\n", mixing);
+	printf("tail_size: %.4f\n", rv->getGetTailSize()/fs);
+	printf("outputs: %d\n", channels);
+	if (channels > 2)
+		printf("max_correlation: %.4f\n", maxCorr);
+	if (freezeAt >= 0)
+		printf("freeze_drift_db: %.6f\n", drift);
+	printf("ns_per_sample: %.2f\n", best*1e9/n);
+	if (modDepth > 0.0) {
+		printf("ns_per_sample_static: %.2f\n", staticBest*1e9/n);
+		printf("modulation_cost: %.3f\n", best/staticBest);
+		printf("modulation_budget: %.3f\n", budget);
+		printf("within_budget: %s\n", (best <= budget*staticBest) ? "yes" : "no");
+	}
+	bool overBudget = (modDepth > 0.0 && best > budget*staticBest);
+
+	for (int b=0; b<numBands; b++)
+		delete[] edc[b];
+	for (int c=0; c<channels; c++) {
+		delete[] x[c]; delete[] out[c];
+	}
+	delete[] band; delete[] e;
+	delete rv;
+	free(inArr); free(outArr);
+	return overBudget ? 1 : 0;
+}
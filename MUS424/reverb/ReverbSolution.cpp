@@ -10,11 +10,15 @@
 //------------------------------------------------------------------------------
 
 #include "ReverbSolution.h"
+#include "NoDenormals.h"
 #include <math.h>
-#include <stdlib.h>
+#include <string.h>
 
 #define PRE_WARP true
 
+// comment out to run FB through the plain dense product (for A/B comparisons)
+#define STRUCTURED_MIXING
+
 //------------------------------------------------------------------------------
 AudioEffect* createEffectInstance (audioMasterCallback audioMaster)
 {
@@ -51,11 +55,28 @@ Reverb::Reverb (audioMasterCallback audioMaster)
     
 	WetDryKnob = 0.2;		// output (wet/dry) mix
     
-	for(int i=0; i<kNumDelays; i++){		
-		dl[i].SetDelay(dlens[i]);						// set reverb delay lengths
-		designShelf(pcoefs,dlens[i], TransitionValue, T60LowValue, T60HighValue);	// design filters for feedback loop
-		fbfilt[i].SetCoefs(coefs);							// assign filter coefs
-	}
+	shelvesDirty = false;
+	FreezeKnob = 0.0;
+	freezeDirty = false;
+	erGain = 1.0; erStep = 0.0; erRampLeft = 0;
+	memset(shelfKey, 0, sizeof(shelfKey));
+	modDepth = kFDNModDepth;
+	modRate = kFDNModRate;
+	roomSize = kRoomSize;
+	idle = false;
+	quietFrames = 0;
+	flushDenormals = true;
+	numIn = kNumInputs;
+	numOut = kNumOutputs;
+	memset(lfe, 0, sizeof(lfe));
+	inArr = outArr = 0;										// plain stereo until the host asks for more
+	allocateArrangement(&inArr, kNumInputs);
+	allocateArrangement(&outArr, kNumOutputs);
+	inArr->type = outArr->type = kSpeakerArrStereo;
+	inArr->speakers[0].type = outArr->speakers[0].type = kSpeakerL;
+	inArr->speakers[1].type = outArr->speakers[1].type = kSpeakerR;
+	fdn.SetStorage(kFDNStorage);							// float or double delay lines
+	setOrder(kFDNOrder, kFDNMatrix);						// generate and load the FDN
     
     ParametricFcValue = 5000.0;
     ParametricFcKnob = SmartKnob::value2knob(ParametricFcValue, ParametricFcLimits, ParametricFcTaper);
@@ -71,10 +92,237 @@ Reverb::Reverb (audioMasterCallback audioMaster)
     
 }
 
+//------------------------------------------------------------------------------
+void Reverb::setOrder(int order, int matrix)
+{
+	requestedOrder = order;
+	numDelays = max(max(4, numOut), min(order, kMaxMixOrder));	// at least a line per output channel
+	matrixKind = matrix;
+    
+	FDNAlternatingTaps(InVecL, InVecR, OutVecL, OutVecR, numDelays);
+	designOutputs();
+	switch (matrix) {
+		case kFDNHouseholder:	FDNHouseholderMatrix(FB, numDelays);						break;
+		case kFDNRandom:		FDNRandomMatrix(FB, numDelays, kFDNRandomDecay, numDelays);	break;
+		default:				FDNHadamardMatrix(FB, numDelays);							break;
+	}
+    
+#ifdef STRUCTURED_MIXING
+	fdn.mixer.SetMatrix(FB, numDelays, true);			// detect Hadamard/Householder structure
+#else
+	fdn.mixer.SetMatrix(FB, numDelays, false);
+#endif
+    
+	setDelays();
+}
+
+//------------------------------------------------------------------------------
+// Stereo keeps the alternating taps. Any other layout reads every channel
+// off the same lines through orthogonal rows, so the channels are mutually
+// uncorrelated; subwoofer feeds get no tail at all.
+void Reverb::designOutputs()
+{
+	int c, l;
+	if (numOut == 2) {
+		for (l=0; l<numDelays; l++) {
+			OutTaps[l] = OutVecL[l];
+			OutTaps[numDelays + l] = OutVecR[l];
+		}
+	} else
+		FDNOutputTaps(OutTaps, numOut, numDelays, 0x0DD5EED);
+	for (c=0; c<numOut; c++)
+		if (lfe[c])
+			memset(OutTaps + c*numDelays, 0, numDelays*sizeof(double));
+}
+
+//------------------------------------------------------------------------------
+void Reverb::setStorage(int format)
+{
+	fdn.SetStorage(format);
+	setDelays();											// re-reserve the pool in the new format
+}
+
+//------------------------------------------------------------------------------
+void Reverb::setDelays()
+{
+	long size = 1;
+	while (size < kLongestDelay*kMaxPoolRate/kDesignRate + kMaxFDNBlock + kFDNModHeadroom)
+		size <<= 1;
+	fdn.Reserve(size*numDelays);							// one allocation covers every rate up to kMaxPoolRate
+    
+	double scale = fs/kDesignRate;
+	FDNPrimeDelays(dlens, numDelays, kShortestDelay*scale, kLongestDelay*scale);	// mutually prime lengths
+	fdn.SetDelays(dlens, numDelays);						// set reverb delay lengths
+	fdn.SetInputTaps(InVecL, InVecR);
+	fdn.SetOutputTaps(OutTaps, numOut);
+	fdn.SetModulation(modDepth*fs, modRate, fs);			// sweep depth in samples at this rate
+	setRoomSize(roomSize);									// early reflection times are in samples too
+	shelfKey[0] = 0.0;										// lengths changed, cached design is stale
+	designShelves();
+	if (fdn.GetFreeze())									// the design above isn't lossless
+		fdn.SetFreeze(true, 0);
+}
+
+//------------------------------------------------------------------------------
+void Reverb::setModulation(double depth, double rate)
+{
+	modDepth = depth;
+	modRate = rate;
+	fdn.SetModulation(modDepth*fs, modRate, fs);
+}
+
+//------------------------------------------------------------------------------
+void Reverb::setRoomSize(double size)
+{
+	long delays[2][kMaxERTaps];
+	double gains[2][kMaxERTaps];
+	int sources[2][kMaxERTaps];
+    
+	roomSize = max(1.0, min(size, kMaxRoomSize));
+	early.Reserve((long)(2.0*kMaxRoomSize/kSpeedOfSound*kMaxPoolRate) + 1, kMaxFDNBlock);
+	for (int c=0; c<2; c++)									// a different seed per side decorrelates them
+		ERDesignTaps(delays[c], gains[c], sources[c], kERTaps, c, roomSize, fs, 0x5EED0 + c);
+	early.SetTaps(delays[0], gains[0], sources[0], delays[1], gains[1], sources[1], kERTaps);
+}
+
+//------------------------------------------------------------------------------
+// Same design as designShelf(), batched over the delay lines: the tan() and
+// the pole are shared, each line only needs its two exp() gains. Nothing is
+// redone if fs, the T60s and the transition are what the current
+// coefficients were designed for. With frames > 0 the shelves glide to the
+// new design over that many frames instead of jumping.
+void Reverb::designShelves(int frames)
+{
+	if (shelfKey[0] == fs && shelfKey[1] == T60LowValue && shelfKey[2] == T60HighValue
+		&& shelfKey[3] == TransitionValue)
+		return;
+	shelfKey[0] = fs; shelfKey[1] = T60LowValue; shelfKey[2] = T60HighValue; shelfKey[3] = TransitionValue;
+    
+	double t60low = T60LowValue, t60high = T60HighValue;
+	double transition = TransitionValue;
+	transition *= 2*M_PI;							// transition in radians
+#ifdef PRE_WARP
+	transition = 2*fs*tan(transition/(2*fs));
+	double c = 2*fs;
+#else
+	double c = transition / tan( transition/(2*fs) );
+#endif
+	double a1 = 1.0f/transition;					// pole at the transition frequency
+	double norm = 1 + a1*c;
+    
+	for (int i=0; i<numDelays; i++) {
+		double roundTrip = ((double)(dlens[i]))/fs;
+		double b0 = exp(roundTrip*log(0.001)/t60low);		// low frequency asymptote
+		double b1 = a1*exp(roundTrip*log(0.001)/t60high);	// high frequency asymptote
+		coefs[0] = (b0 + b1*c)/norm;
+		coefs[1] = (b0 - b1*c)/norm;
+		coefs[2] = (1 - a1*c)/norm;
+		if (frames > 0)
+			fdn.fbfilt.SetTarget(i, coefs);
+		else
+			fdn.fbfilt.SetCoefs(i, coefs);
+	}
+	if (frames > 0)
+		fdn.fbfilt.StartRamp(frames);
+}
+
+//------------------------------------------------------------------------------
+void Reverb::setSampleRate (float sampleRate)
+{
+	AudioEffectX::setSampleRate(sampleRate);
+	if (fs == sampleRate)
+		return;
+	fs = sampleRate;
+    
+	// always called while suspended, so it is safe to lay out the arena again
+	setDelays();
+	designParametric(parametric_coefs, ParametricFcValue, ParametricGammaValue, ParametricQValue);
+	parametric[0].setCoefs(parametric_coefs);
+	parametric[1].setCoefs(parametric_coefs);
+}
+
+//------------------------------------------------------------------------------
+void Reverb::resume ()
+{
+	if (fs != getSampleRate())								// some hosts only update the rate before resuming
+		setSampleRate(getSampleRate());
+	fdn.Reset();											// start from silence
+	early.Reset();
+	freezeDirty = false;									// no glide from nothing
+	fdn.SetFreeze(FreezeKnob >= 0.5, 0);
+	if (!fdn.GetFreeze()) {
+		shelfKey[0] = 0.0;
+		designShelves();
+	}
+	erGain = fdn.GetFreeze() ? 0.0 : 1.0;
+	erRampLeft = 0;
+	idle = false;
+	quietFrames = 0;
+	parametric[0].reset();
+	parametric[1].reset();
+}
+
+//------------------------------------------------------------------------------
+// Frames until an impulse has decayed to kIdleLevel, for hosts that stop
+// calling us (or render offline) once the input has ended: the slower of
+// the two T60s down to the threshold, plus the time to get through the
+// early reflections and the longest line. (Not the dB() macro, which
+// stops at -100 dB.) Frozen, the tail never ends.
+VstInt32 Reverb::getGetTailSize ()
+{
+	if (FreezeKnob >= 0.5)
+		return kInfiniteTail;
+	double decay = max(T60LowValue, T60HighValue)*20.0*log10(kIdleLevel)/-60.0;
+	return (VstInt32)(decay*fs) + settleFrames();
+}
+
+//------------------------------------------------------------------------------
+long Reverb::settleFrames()
+{
+	long longest = 0;
+	for (int i=0; i<numDelays; i++)
+		longest = max(longest, dlens[i]);
+	return longest + (long)(modDepth*fs) + (long)(2.0*roomSize/kSpeedOfSound*fs) + kMaxFDNBlock;
+}
+
+//------------------------------------------------------------------------------
+// Mono or stereo in, anything from mono to kMaxFDNOutputs channels out.
+// The first two outputs carry the dry signal and the early reflections;
+// the rest only get the tail. Called while suspended.
+bool Reverb::setSpeakerArrangement (VstSpeakerArrangement* pluginInput, VstSpeakerArrangement* pluginOutput)
+{
+	if (!pluginInput || !pluginOutput)
+		return false;
+	if (pluginInput->numChannels < 1 || pluginInput->numChannels > 2
+		|| pluginOutput->numChannels < 1 || pluginOutput->numChannels > kMaxFDNOutputs)
+		return false;
+	if (!matchArrangement(&inArr, pluginInput) || !matchArrangement(&outArr, pluginOutput))
+		return false;
+    
+	numIn = pluginInput->numChannels;
+	numOut = pluginOutput->numChannels;
+	setNumInputs(numIn);
+	setNumOutputs(numOut);
+	for (int c=0; c<kMaxFDNOutputs; c++)
+		lfe[c] = (c < numOut) && (pluginOutput->speakers[c].type == kSpeakerLfe
+								  || pluginOutput->speakers[c].type == kSpeakerLfe2);
+	setOrder(requestedOrder, matrixKind);					// a line per output if that is more, else as asked
+	return true;
+}
+
+//------------------------------------------------------------------------------
+bool Reverb::getSpeakerArrangement (VstSpeakerArrangement** pluginInput, VstSpeakerArrangement** pluginOutput)
+{
+	*pluginInput = inArr;
+	*pluginOutput = outArr;
+	return true;
+}
+
 //------------------------------------------------------------------------------
 Reverb::~Reverb ()
 {
-	// nothing to do here
+	deallocateArrangement(&inArr);
+	deallocateArrangement(&outArr);
 }
 
 //------------------------------------------------------------------------------
@@ -94,30 +342,20 @@ void Reverb::setParameter (VstInt32 index, float value)
 {
 	switch (index)
 	{
-        int i;
         case kParamT60low:
             T60LowKnob = value;
             T60LowValue = SmartKnob::knob2value(T60LowKnob, T60LowLimits, T60LowTaper);
-            for (i=0; i<kNumDelays ; i++){
-                designShelf(pcoefs,dlens[i], TransitionValue, T60LowValue, T60HighValue);
-                fbfilt[i].SetCoefs(coefs);
-            }
+            shelvesDirty = true;							// picked up by the next block
             break;
         case kParamT60high:
             T60HighKnob = value;
             T60HighValue = SmartKnob::knob2value(T60HighKnob, T60HighLimits, T60HighTaper);
-            for (i=0; i<kNumDelays ; i++){
-                designShelf(pcoefs,dlens[i], TransitionValue, T60LowValue, T60HighValue);
-                fbfilt[i].SetCoefs(coefs);
-            }
+            shelvesDirty = true;							// picked up by the next block
             break;
         case kParamTransition:
             TransitionKnob = value;
             TransitionValue = SmartKnob::knob2value(TransitionKnob, TransitionLimits, TransitionTaper);
-            for (i=0; i<kNumDelays ; i++){
-                designShelf(pcoefs,dlens[i], TransitionValue, T60LowValue, T60HighValue);
-                fbfilt[i].SetCoefs(coefs);
-            }
+            shelvesDirty = true;							// picked up by the next block
             break;
         case kParamWetDry:
             WetDryKnob = value;
@@ -143,6 +381,10 @@ void Reverb::setParameter (VstInt32 index, float value)
             parametric[0].setCoefs(parametric_coefs);
             parametric[1].setCoefs(parametric_coefs);
             break;
+        case kParamFreeze:
+            FreezeKnob = value;
+            freezeDirty = true;								// picked up by the next block
+            break;
             
         default :
             break;
@@ -175,6 +417,9 @@ float Reverb::getParameter (VstInt32 index)
         case kParamFc:
             return ParametricFcKnob;
             break;
+        case kParamFreeze:
+            return FreezeKnob;
+            break;
         default :
             return 0.0;
 	};
@@ -206,6 +451,9 @@ void Reverb::getParameterName (VstInt32 index, char* label)
         case kParamFc:
             vst_strncpy(label, " Fc ", kVstMaxParamStrLen);
             break;
+        case kParamFreeze:
+            vst_strncpy(label, " Freeze ", kVstMaxParamStrLen);
+            break;
         default :
             *label = '\0';
             break;
@@ -238,6 +486,9 @@ void Reverb::getParameterDisplay (VstInt32 index, char* text)
         case kParamFc:
             float2string(ParametricFcValue, text, kVstMaxParamStrLen);
             break;
+        case kParamFreeze:
+            vst_strncpy(text, (FreezeKnob >= 0.5) ? "on" : "off", kVstMaxParamStrLen);
+            break;
         default :
             *text = '\0';
             break;
@@ -270,6 +521,9 @@ void Reverb::getParameterLabel (VstInt32 index, char* label)
         case kParamFc:
             vst_strncpy(label, " Hz ", kVstMaxParamStrLen);
             break;
+        case kParamFreeze:
+            vst_strncpy(label, " ", kVstMaxParamStrLen);
+            break;
         default :
             *label = '\0';
             break;
@@ -387,57 +641,165 @@ void Reverb::designShelf(double* pcofs, long theLength, double transition, doubl
 
 
 
+//------------------------------------------------------------------------------
+// Decay time implied by the shelf at freq, for measurement tools to compare
+// against. Every line is designed for the same T60, so the first one will do.
+double Reverb::shelfT60(double freq)
+{
+	designShelf(pcoefs, dlens[0], TransitionValue, T60LowValue, T60HighValue);
+	double w = 2*M_PI*freq/fs;
+	double nr = coefs[0] + coefs[1]*cos(w), ni = -coefs[1]*sin(w);
+	double dr = 1 + coefs[2]*cos(w), di = -coefs[2]*sin(w);
+	double mag = sqrt((nr*nr + ni*ni)/(dr*dr + di*di));
+	return -3.0*dlens[0]/(fs*log10(mag));
+}
+
+
+
 //------------------------------------------------------------------------------
 void Reverb::processReplacing (float** inputs, float** outputs, VstInt32 sampleFrames)
 {
 	float*	in0		= inputs[0];
-	float*  in1     = inputs[1];
-	float*	out0	= outputs[0];
-	float*  out1    = outputs[1];
-    
+	float*  in1     = (numIn > 1) ? inputs[1] : inputs[0];	// mono in feeds both sides
+	int		front	= min(numOut, 2);						// outputs with dry and early reflections
+	long	done	= 0;
+	int		c;
+	double*	wetOut[kMaxFDNOutputs];
+	for (c = 0; c < numOut; c++)
+		wetOut[c] = wet[c];
+    
+	// flush denormals to zero while the tail decays (instead of adding noise)
+	ScopedNoDenormals noDenormals(flushDenormals);
+    
+	// any input above the threshold wakes the network up at once
+	float peak = 0.0f;
 	for (int i = 0; i < sampleFrames; i++)
-	{        
-        // denormal was a problem in Pentium 4 CPUs. This is obsolete now, but 
-        // we left it in the code for historical reasons
-		int noise=rand()-16384;
-		double inp0=(*in0)+(float)(noise)*6.103515623e-015;	// additive noise to prevent denormal
-		double inp1=(*in1)+(float)(noise)*6.103515623e-015;	// problem on P4 (bad for reverbs).
-        
-        // TODO: connect the Parametric section for problem 2
+		peak = max(peak, max(fabsf(in0[i]), fabsf(in1[i])));
+	bool silent = (peak <= kIdleLevel);
+	if (!silent) {
+		idle = false;
+		quietFrames = 0;
+	}
+    
+	// freeze: the network holds what it has and new input stays out of it;
+	// unfreezing glides the shelves back to the current T60s
+	if (freezeDirty) {
+		freezeDirty = false;
+		bool on = (FreezeKnob >= 0.5);
+		if (on != fdn.GetFreeze()) {
+			int frames = idle ? 0 : (int)(kFreezeTime*fs);
+			fdn.SetFreeze(on, frames);
+			if (!on) {
+				shelfKey[0] = 0.0;
+				shelvesDirty = false;
+				designShelves(max(frames, 1));
+			}
+			double target = on ? 0.0 : 1.0;
+			erRampLeft = frames;
+			if (frames > 0)
+				erStep = (target - erGain)/frames;
+			else
+				erGain = target;
+		}
+	}
+    
+	// at most one shelf redesign per block, however often the T60s moved;
+	// none while frozen, the lossless shelves stay put until unfreezing
+	if (shelvesDirty && !fdn.GetFreeze()) {
+		shelvesDirty = false;
+		designShelves(idle ? 0 : min(sampleFrames, kMaxFDNBlock));	// no need to glide if nothing is ringing
+	}
+    
+	// nothing left in the network: just the (silent) dry part
+	if (idle) {
+		for (int i = 0; i < sampleFrames; i++) {
+			if (numOut == 1)
+				outputs[0][i] = 0.5*(in0[i] + in1[i])*(1.0-WetDryKnob);
+			else {
+				outputs[0][i] = in0[i]*(1.0-WetDryKnob);
+				outputs[1][i] = in1[i]*(1.0-WetDryKnob);
+			}
+		}
+		for (c = front; c < numOut; c++)
+			memset(outputs[c], 0, sampleFrames*sizeof(float));
+		return;
+	}
+    
+	while (sampleFrames > 0)
+	{
+		int block = min(sampleFrames, kMaxFDNBlock);
+		int i;
         
-//        // parametric section at the input
-//        parametric[0].process(inp0, inp0);
-//        parametric[1].process(inp1, inp1);
+		for (i = 0; i < block; i++)
+		{
+			dry[0][i]=in0[done+i];
+			dry[1][i]=in1[done+i];
+            
+            // TODO: connect the Parametric section for problem 2
+            
+//            // parametric section at the input
+//            parametric[0].process(dry[0][i], dry[0][i]);
+//            parametric[1].process(dry[1][i], dry[1][i]);
+		}
         
+		if (erRampLeft > 0 || erGain != 1.0) {						// fading in or out of freeze
+			for (i = 0; i < block; i++) {
+				er[0][i] = dry[0][i]*erGain;
+				er[1][i] = dry[1][i]*erGain;
+				if (erRampLeft > 0)
+					erGain = (--erRampLeft > 0) ? erGain + erStep : (fdn.GetFreeze() ? 0.0 : 1.0);
+			}
+			early.Process(er[0], er[1], er[0], er[1], block);
+		} else
+			early.Process(dry[0], dry[1], er[0], er[1], block);		// early reflections feed the FDN
+		fdn.Process(er[0], er[1], wetOut, block);					// run the delay network on the whole block
         
-		double accum,OutL,OutR;
-		int dlind,sumind;
+		if (numOut == 1)											// mono out: fold the front pair
+			for (i = 0; i < block; i++) {
+				er[0][i] = 0.5*(er[0][i] + er[1][i]);
+				dry[0][i] = 0.5*(dry[0][i] + dry[1][i]);
+			}
         
-		OutL=0.0;OutR=0.0;
+		double wetPeak = 0.0;
         
-		for (dlind=0; dlind<kNumDelays ; dlind++)
+		for (c = 0; c < front; c++)
 		{
-			accum=0.0;
-			for (sumind=0; sumind<kNumDelays ; sumind++)		
+			float* out = outputs[c] + done;
+			for (i = 0; i < block; i++)
 			{
-				accum+=FB[dlind][sumind]*dl[sumind].Read();			// add up contributions from each delay line through orthonormal matrix
+				wet[c][i] += kERLevel*er[c][i];						// early reflections on top of the tail
+				wetPeak = max(wetPeak, fabs(wet[c][i]));
+                
+                // parametric section at the output
+                // parametric[c].process(wet[c][i], wet[c][i]);
+                
+				out[i] = wet[c][i]*WetDryKnob + dry[c][i]*(1.0-WetDryKnob);	// compute wet/dry output
 			}
-			OutL+=OutVecL[dlind]*accum; OutR+=OutVecR[dlind]*accum;	// sum into L,R busses
-			accum+=InVecL[dlind]*inp0+InVecR[dlind]*inp1;			// add in L,R contributions for current line
-			fbfilt[dlind].Process(accum,accum);						// filter data with shelf
-			dl[dlind].Write(accum);									// write back into current delay line
 		}
-		for (dlind=0; dlind<kNumDelays ; dlind++)
-			dl[dlind].UpdatePointers();								// advance read, write pointers
-
-        // parametric section at the output
-        // parametric[0].process(OutL, OutL);
-        // parametric[1].process(OutR, OutR);
-        
+		for (c = front; c < numOut; c++)							// surrounds: tail only
+		{
+			float* out = outputs[c] + done;
+			for (i = 0; i < block; i++)
+			{
+				wetPeak = max(wetPeak, fabs(wet[c][i]));
+				out[i] = wet[c][i]*WetDryKnob;
+			}
+		}
+		sampleFrames -= block;
+		done += block;
         
-		*out0++ = OutL*WetDryKnob + inp0*(1.0-WetDryKnob);			// compute wet/dry output
-		*out1++ = OutR*WetDryKnob + inp1*(1.0-WetDryKnob);
-		in0++;in1++;
+		if (silent && wetPeak <= kIdleLevel && fdn.Energy() <= kIdleLevel*kIdleLevel)
+			quietFrames += block;
+		else
+			quietFrames = 0;
+	}
+    
+	// once the lines have stayed under the threshold for longer than
+	// anything can stay in them, clear them and stop running the network
+	if (quietFrames > settleFrames()) {
+		idle = true;
+		fdn.Reset();
+		early.Reset();
 	}
 }
 
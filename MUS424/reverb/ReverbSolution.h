@@ -13,6 +13,9 @@
 #define __Reverb__
 
 #include "public.sdk/source/vst2.x/audioeffectx.h"
+#include "FDN.h"
+#include "FDNDesign.h"
+#include "EarlyReflections.h"
 #include <math.h>
 
 #ifndef max
@@ -34,64 +37,24 @@
 
 #define kMaxLen			32
 
-
-//------------------------------------------------------------------------------
-//  one-pole, one-zero shelf filter
-struct HalfBiquad {			
-    double	a1, b0, b1, z1;
-    
-    HalfBiquad()		{	this->a1=0.0; this->b0=1.0; this->b1=0.0; Reset();	}
-    void	SetCoefs (double* coefs)		//pointer to array: [b0 b1 a1 a2]
-    {	this->a1=*(coefs+2); this->b0=*(coefs); this->b1=*(coefs+1);}
-    void	Reset()	{	z1=0; }
-    void	Process (double input, double& output)
-    {
-        //Transposed Direct II Form (PREFERRED)
-        output = z1+input*b0;
-        z1 = input*b1-output*a1;
-        
-    }
-};
-
-
-//------------------------------------------------------------------------------
-//  delay line
-#define kMaxDelay 8192
-struct DelayLine {			// delay line
-    double	dly[kMaxDelay];							// double-precision delay line
-    long	wp,rp,theDelay;							// read, write pointers and delay length
-    DelayLine()		{
-        int indx;
-        for (indx=0; indx<kMaxDelay ; indx++){
-            dly[indx]=0.0;							// clear delay line on instantiation
-        }
-        wp=0;rp=0;									// init write and read pointers to zero
-    }
-    void SetDelay(long aDelay)
-    {	theDelay=aDelay;}
-    void Write(double data)
-    {
-        dly[wp] = data;
-    }								// write data into line
-    double Read()
-    {
-        return dly[rp];
-    }							// read data from line
-    void UpdatePointers()							// advance read, write pointers
-    {
-        wp--;
-        if (wp < 0)
-            wp = kMaxDelay-1;
-        rp = wp + theDelay;
-        if (rp > kMaxDelay-1)
-            rp -= kMaxDelay;
-        if (rp > kMaxDelay-1)
-            rp = kMaxDelay-1;
-        if (rp < 0)
-            rp = 0;
-    }
-};
-
+// FDN built at load time; order can be anything from 4 to kMaxMixOrder
+#define kFDNOrder		12				// number of delay lines
+#define kFDNMatrix		kFDNHadamard	// kFDNHadamard, kFDNHouseholder or kFDNRandom
+#define kFDNRandomDecay	0.0				// dcy for kFDNRandom (orthonorm.m)
+#define kFDNStorage		kFDNStoreFloat	// delay line format, kFDNStoreDouble for reference renders
+#define kShortestDelay	2023			// delay lengths are spread over this range, samples
+#define kLongestDelay	4011			// at kDesignRate, and scaled with the sample rate
+#define kDesignRate		44100.0
+#define kMaxPoolRate	192000.0		// the delay arena is sized for this rate up front
+#define kFDNModDepth	0.0				// delay sweep, seconds; static lines unless setModulation() asks
+#define kFDNModRate		0.6				// delay sweep rate, Hz
+#define kRoomSize		12.0			// metres; sets the early reflection pattern
+#define kMaxRoomSize	40.0			// the early reflection buffer is sized for this
+#define kERTaps			24				// early reflection taps per side
+#define kERLevel		0.7				// early reflections in the wet signal, re the tail
+#define kIdleLevel		1e-6			// -120 dB: input and tail below this count as silence
+#define kFreezeTime		0.05			// seconds to glide into and out of freeze
+#define kInfiniteTail	0x7FFFFFFF		// getGetTailSize() while frozen: VST2 has no "infinite", the longest there is
 
 
 //------------------------------------------------------------------------------
@@ -139,6 +102,11 @@ public:
     
 	// Processing
 	virtual void processReplacing (float** inputs, float** outputs, VstInt32 sampleFrames);
+	virtual void setSampleRate (float sampleRate);
+	virtual void resume ();
+	virtual VstInt32 getGetTailSize ();
+	virtual bool setSpeakerArrangement (VstSpeakerArrangement* pluginInput, VstSpeakerArrangement* pluginOutput);
+	virtual bool getSpeakerArrangement (VstSpeakerArrangement** pluginInput, VstSpeakerArrangement** pluginOutput);
     
 	// Program
 	virtual void setProgramName (char* name);
@@ -156,13 +124,23 @@ public:
 	virtual bool getProductString (char* text);
 	virtual VstInt32 getVendorVersion ();
     
+	void setOrder(int order, int matrix);		// rebuild the FDN; call while suspended
+	void setStorage(int format);				// kFDNStoreDouble/Float; call while suspended
+	void setDelays();							// delay lengths and shelves for the current fs
+	void setModulation(double depth, double rate);	// sweep in seconds (0 = off) and Hz; call while suspended
+	void setRoomSize(double size);				// early reflections for a room size metres across; call while suspended
+	void designShelves(int frames = 0);			// all lines at once, cached; ramped over frames
 	void designShelf(double* pcofs, long theLength, double transition, double T60low, double T60high);
+	double shelfT60(double freq);				// T60 the current shelf design gives at freq, seconds
     void bilinearTransform(double acoefs[], double dcoefs[]);
     void designParametric(double* dcoefs, double center, double gain, double qval);
 
     
     
 protected:
+	long settleFrames();						// longest any input can stay in the network, samples
+	void designOutputs();						// output taps for the current speaker arrangement
+
 	// param IDs
 	enum {
 		kParamT60low	= 0,
@@ -172,6 +150,7 @@ protected:
         kParamQ,
         kParamGamma,
         kParamFc,
+        kParamFreeze,
 		kNumParams
 	};
     
@@ -184,6 +163,7 @@ protected:
     float ParametricQKnob, ParametricQValue;
     float ParametricGammaKnob, ParametricGammaValue;
     float ParametricFcKnob, ParametricFcValue;
+    float FreezeKnob;	// on above one half
 	
 	// config
 	enum { 
@@ -197,9 +177,29 @@ protected:
     
 	// internal state var declaration and initialization
 	double fs;
-#define kNumDelays	12
-	HalfBiquad fbfilt[kNumDelays];
-	DelayLine dl[kNumDelays];
+	int numDelays;										// FDN order
+	int requestedOrder;									// order asked of setOrder(), before the output count
+	int matrixKind;										// kFDNHadamard, kFDNHouseholder or kFDNRandom
+	long dlens[kMaxMixOrder];							// delay lengths, samples
+	float InVecL[kMaxMixOrder], InVecR[kMaxMixOrder];	// input taps
+	float OutVecL[kMaxMixOrder], OutVecR[kMaxMixOrder];	// output taps
+	double OutTaps[kMaxFDNOutputs*kMaxMixOrder];		// taps actually loaded, [channel][line]
+	int numIn, numOut;									// channels the host negotiated
+	bool lfe[kMaxFDNOutputs];							// output is a subwoofer feed: no tail
+	VstSpeakerArrangement *inArr, *outArr;				// copies for getSpeakerArrangement()
+	double FB[kMaxMixOrder*kMaxMixOrder];				// orthonormal feedback matrix, row-major
+	FDN fdn;											// delay lines, FB and fbfilt shelves
+	bool shelvesDirty;									// T60/transition moved, redesign at next block
+	bool freezeDirty;									// freeze switched, picked up at the next block
+	double erGain, erStep;								// early reflection input, faded out while frozen
+	long erRampLeft;
+	double shelfKey[4];									// fs, T60low, T60high, transition of the current design
+	double modDepth, modRate;							// delay modulation, seconds and Hz
+	EarlyReflections early;								// taps in front of the FDN
+	double roomSize;									// metres
+	bool idle;											// tail has died away, the network is skipped
+	long quietFrames;									// frames of silent input and sub-threshold lines so far
+	bool flushDenormals;								// FTZ/DAZ in processReplacing; off only to measure it
 	double coefs[3];
 	double*	pcoefs;
     
@@ -207,14 +207,14 @@ protected:
     double parametric_coefs[5];
     Biquad parametric[2];
     
+    // block buffers between the host and the FDN
+    double dry[2][kMaxFDNBlock];
+    double er[2][kMaxFDNBlock];
+    double wet[kMaxFDNOutputs][kMaxFDNBlock];
+    
     
 };
 
-const static float InVecL[kNumDelays]={1.0,0.0,1.0,0.0,1.0,0.0,1.0,0.0,1.0,0.0,1.0,0.0};
-const static float InVecR[kNumDelays]={0.0,1.0,0.0,1.0,0.0,1.0,0.0,1.0,0.0,1.0,0.0,1.0};
-const static float OutVecL[kNumDelays]={1.0,0.0,1.0,0.0,1.0,0.0,1.0,0.0,1.0,0.0,1.0,0.0};
-const static float OutVecR[kNumDelays]={0.0,1.0,0.0,1.0,0.0,1.0,0.0,1.0,0.0,1.0,0.0,1.0};
-const static float dlens[kNumDelays]={2023,2153,2291,2438,2595,2761,2939,3127,3328,3542,3769,4011};
 
 
 // UI controls limits and tapers
@@ -238,94 +238,8 @@ const static float ParametricQTaper = -1.0;
 
 
 
-/* const static double FB[kNumDelays][kNumDelays]={
-    //Identity Mixing Matrix (no mixing, actually)
-    {+1.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, },
-    {+0.00000, +1.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, },
-    {+0.00000, +0.00000, +1.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, },
-    {+0.00000, +0.00000, +0.00000, +1.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, },
-    {+0.00000, +0.00000, +0.00000, +0.00000, +1.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, },
-    {+0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +1.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, },
-    {+0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +1.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, },
-    {+0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +1.00000, +0.00000, +0.00000, +0.00000, +0.00000, },
-    {+0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +1.00000, +0.00000, +0.00000, +0.00000, },
-    {+0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +1.00000, +0.00000, +0.00000, },
-    {+0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +1.00000, +0.00000, },
-    {+0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +0.00000, +1.00000, },
-    
- }; */
-
-// TODO: replace the identity "mixing" matrix with a matrix that actaully mixes! 
-// You can use the Hadamard matrix provided below or you can create a different
-// one using the orthonorm.m matlab script provided.
-
-    
-
- //Hadamard Mixing Matrix
- const static double FB[kNumDelays][kNumDelays]={	
- {0.2887,    0.2887,    0.2887,    0.2887,    0.2887,    0.2887,    0.2887,    0.2887,    0.2887,    0.2887,    0.2887,    0.2887,},
- {0.2887,   -0.2887,    0.2887,   -0.2887,    0.2887,    0.2887,    0.2887,   -0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,},
- {0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,    0.2887,    0.2887,    0.2887,   -0.2887,   -0.2887,   -0.2887,    0.2887,},
- {0.2887,    0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,    0.2887,    0.2887,    0.2887,   -0.2887,   -0.2887,   -0.2887,},
- {0.2887,   -0.2887,    0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,    0.2887,    0.2887,    0.2887,   -0.2887,   -0.2887,},
- {0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,    0.2887,    0.2887,    0.2887,   -0.2887,},
- {0.2887,   -0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,    0.2887,    0.2887,    0.2887,},
- {0.2887,    0.2887,   -0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,    0.2887,    0.2887,},
- {0.2887,    0.2887,    0.2887,   -0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,    0.2887,},
- {0.2887,    0.2887,    0.2887,    0.2887,   -0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,},
- {0.2887,   -0.2887,    0.2887,    0.2887,    0.2887,   -0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,   -0.2887,    0.2887,},
- {0.2887,    0.2887,   -0.2887,    0.2887,    0.2887,    0.2887,   -0.2887,   -0.2887,   -0.2887,    0.2887,   -0.2887,   -0.2887,},
- };
-
-
-//Random Mixing Matrix generated with orthonorm.m, dcy = 0
-/* const static double FB[kNumDelays][kNumDelays]={
-    
-    {-0.04847, -0.17288, -0.23635, -0.52946, -0.23560, +0.16995, +0.29591, +0.03690, +0.42629, +0.15084, +0.36397, +0.34829, },
-    {-0.44432, -0.38392, +0.44898, +0.44657, -0.01030, -0.04918, +0.22425, -0.10791, +0.19304, -0.06870, -0.02037, +0.38383, },
-    {-0.16270, -0.38060, -0.37445, +0.12547, -0.00376, +0.18013, +0.26726, +0.07370, +0.30189, -0.21492, -0.27043, -0.59409, },
-    {-0.17087, -0.29272, +0.22427, -0.41500, +0.32503, -0.14665, +0.32731, +0.18663, -0.52384, -0.18442, +0.23249, -0.17612, },
-    {-0.38613, -0.03649, -0.69953, +0.19442, -0.01122, -0.06413, -0.07095, +0.03154, -0.42670, -0.04673, +0.01413, +0.35737, },
-    {+0.55569, -0.29000, -0.04017, +0.24640, -0.40354, +0.05674, +0.40270, -0.23051, -0.37491, +0.14574, +0.03057, +0.02614, },
-    {-0.08730, +0.23644, -0.10955, +0.25807, +0.50241, +0.14388, +0.28903, -0.31895, +0.05450, +0.46202, +0.38453, -0.18759, },
-    {+0.12821, -0.35224, -0.10105, +0.18830, -0.02110, -0.62189, -0.27787, +0.28836, +0.17454, +0.27222, +0.36841, -0.16113, },
-    {+0.01103, -0.28736, -0.06791, -0.33320, +0.25180, -0.28840, -0.06267, -0.42858, +0.01936, +0.38264, -0.55599, +0.10761, },
-    {+0.19522, +0.11562, -0.01982, +0.11691, +0.25636, +0.03176, +0.34268, +0.69524, +0.04381, +0.27715, -0.35905, +0.24351, },
-    {+0.44237, -0.03685, -0.18095, +0.07652, +0.46317, -0.18330, +0.08495, -0.17141, +0.22201, -0.58825, +0.08792, +0.27671, },
-    {+0.16938, -0.47903, +0.03365, +0.03423, +0.28150, +0.61820, -0.47650, +0.10633, -0.08841, +0.10988, +0.09718, +0.10209, },
-}; */
-
-// orthonorm.m with dcy = 1
-/* const static double FB[kNumDelays][kNumDelays] = {
-    {+0.68063, +0.65695, -0.02222, +0.17453, +0.15966, +0.02324, +0.13698, -0.12948, +0.01756, +0.08576, +0.05356, +0.04609, },
-    {-0.57162, +0.63206, +0.34907, -0.23943, +0.18474, -0.13244, -0.10535, -0.10434, -0.09514, +0.02679, +0.03456, -0.09978, },
-    {+0.23719, -0.14101, +0.84427, +0.14024, -0.30732, -0.17248, +0.03942, +0.19417, -0.06300, +0.00684, +0.08756, -0.12750, },
-    {-0.30377, +0.26335, -0.13640, +0.36354, -0.62488, +0.26767, +0.38074, +0.08643, +0.15181, +0.22113, -0.00497, -0.03280, },
-    {-0.19764, -0.09091, +0.14765, +0.79978, +0.41925, +0.21377, -0.14088, -0.16328, -0.06935, -0.11215, -0.07285, -0.02345, },
-    {-0.00681, -0.17977, +0.24291, -0.28926, +0.34237, +0.51501, +0.62727, -0.15290, +0.01748, +0.12765, -0.01198, -0.09444, },
-    {-0.07800, +0.02560, -0.06782, +0.11741, +0.38534, -0.35941, +0.28764, +0.68434, +0.31726, +0.16145, -0.13236, -0.04382, },
-    {+0.08086, +0.13305, -0.04300, -0.09490, +0.01474, +0.57407, -0.34313, +0.59654, -0.32673, -0.02362, +0.00377, -0.23283, },
-    {+0.03687, +0.06065, +0.21751, -0.11665, -0.03186, +0.31326, -0.33544, -0.00564, +0.73935, -0.05994, -0.31626, +0.26852, },
-    {+0.03896, -0.08464, +0.03864, -0.00447, +0.00977, -0.05227, -0.18753, -0.11226, -0.23520, +0.80280, -0.48545, +0.06111, },
-    {+0.03045, -0.08903, -0.07423, +0.01535, +0.06434, +0.00579, -0.23542, -0.14883, +0.38485, +0.37010, +0.48567, -0.61863, },
-    {-0.07698, -0.04452, +0.06849, +0.02013, +0.09225, +0.09986, -0.08196, +0.13479, -0.03230, +0.32004, +0.62747, +0.66817, },
-}; */
-
-// orthonorm.m with dcy = 0.5
-/* const static double FB[kNumDelays][kNumDelays] = {
-    {+0.56448, -0.31082, +0.24745, -0.22413, +0.15398, +0.50784, +0.04963, -0.26284, +0.33072, +0.02909, -0.09889, -0.01141, },
-    {+0.54841, +0.58607, +0.22291, -0.01363, -0.08806, -0.28328, +0.32730, -0.14268, -0.17527, -0.01833, +0.22690, +0.08869, },
-    {-0.34346, +0.06826, +0.54892, -0.54973, +0.05315, -0.35055, +0.02011, -0.07134, +0.27673, +0.06821, -0.10172, -0.22601, },
-    {-0.09231, -0.13748, +0.34250, +0.68550, +0.22212, -0.18917, +0.18735, +0.01415, +0.46244, +0.04839, +0.18660, +0.11796, },
-    {+0.02467, +0.49286, +0.00187, +0.05806, +0.67518, +0.10761, -0.36264, +0.12814, +0.02948, +0.07994, -0.34436, +0.10906, },
-    {-0.26722, +0.33138, +0.04461, -0.03946, -0.13672, +0.54962, +0.54487, +0.39405, +0.13359, +0.15006, -0.03632, -0.02480, },
-    {-0.18074, +0.11428, -0.39947, -0.07523, +0.38098, +0.07339, +0.17661, -0.46012, +0.09465, +0.13268, +0.46269, -0.39366, },
-    {+0.08186, -0.05649, -0.46710, -0.32514, +0.06195, -0.29706, +0.18899, +0.13265, +0.44550, +0.12604, -0.01069, +0.55349, },
-    {-0.07006, +0.27368, +0.09523, -0.04910, -0.33676, +0.23616, -0.58073, -0.01460, +0.29346, +0.10181, +0.51275, +0.20657, },
-    {-0.27648, +0.07823, +0.07229, +0.11227, -0.17060, +0.10398, +0.08164, -0.65300, -0.15603, +0.35590, -0.31794, +0.41775, },
-    {+0.15635, -0.20829, +0.08528, -0.02499, +0.08188, -0.09038, -0.05842, +0.27106, -0.25014, +0.85958, +0.15645, -0.08117, },
-    {-0.19218, -0.20729, +0.26295, -0.21338, +0.37898, +0.14542, +0.11080, +0.06457, -0.41267, -0.23133, +0.41351, +0.47897, },
-}; */
+// the feedback matrix, delay lengths and taps are generated in setOrder(),
+// see FDNDesign.h (the random family replaces the orthonorm.m tables)
 
 
 
@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : Antiderivative.h
+// Created by   : music424 staff
+// Company      : CCRMA - Stanford University
+// Description  : The Distortion's hard and soft clip curves with antiderivative
+//                antialiasing (ADAA). Instead of the curve at each sample, the
+//                shaper puts out the curve's average over the straight line
+//                from the last sample to this one (first order), or over the
+//                last three samples with triangular weights (second order).
+//                Both come from the curve's antiderivatives in closed form.
+//                Averaging is a lowpass on the curve's output, so much less of
+//                what the curve makes above Nyquist folds back, and a lower
+//                oversampling factor does. First order delays by half a
+//                sample, second order by one. Without antialiasing, blocks
+//                go through the curve four samples at a time.
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __Antiderivative__
+#define __Antiderivative__
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AD_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define AD_NEON 1
+#endif
+
+#define kADAAMaxOrder       2
+#define kADAATolerance      1e-4        // closer inputs than this take the limit
+
+
+//------------------------------------------------------------------------------
+struct AntiderivativeShaper {
+
+	enum { kHardClip, kSoftClip };
+
+	int     curve;		// kHardClip, min(1, max(-1, x)), or kSoftClip, x/(1 + |x|)
+	int     order;		// 0 for the curve itself, 1 or 2
+	double  x1, x2;		// the last two inputs
+	double  F1x1, F2x1;	// the antiderivatives at x1
+	double  d1;		// second order: F2's divided difference over x2, x1
+
+	AntiderivativeShaper(int c = kHardClip) {
+		curve = c;
+		order = 0;
+		reset();
+	}
+
+	// 0, 1 or 2; clears the history
+	void setOrder(int o) {
+		order = (o < 0) ? 0 : (o > kADAAMaxOrder) ? kADAAMaxOrder : o;
+		reset();
+	}
+
+	// both curves and their antiderivatives are 0 at 0
+	void reset() {
+		x1 = x2 = 0.0;
+		F1x1 = F2x1 = d1 = 0.0;
+	}
+
+	// delay, in samples at the rate the shaper runs at
+	static double delayFor(int o) {
+		return 0.5*o;
+	}
+
+	double process(double x) {
+		double y;
+		if (order == 0)
+			return f(x);
+		if (order == 1) {
+			double a = F1(x);
+			y = (fabs(x - x1) < kADAATolerance) ? f(0.5*(x + x1)) : (a - F1x1)/(x - x1);
+			F1x1 = a;
+		} else {
+			double b = F2(x);
+			double d = (fabs(x - x1) < kADAATolerance) ? F1(0.5*(x + x1)) : (b - F2x1)/(x - x1);
+			if (fabs(x - x2) < kADAATolerance) {
+				// x back where it was two samples ago: the limit, about their mean
+				double m = 0.5*(x + x2), delta = x1 - m;
+				y = (fabs(delta) < kADAATolerance) ? f(m + delta/3.0)
+					: 2.0*(F2x1 - F2(m) - delta*F1(m))/(delta*delta);
+			} else
+				y = 2.0*(d - d1)/(x - x2);
+			d1 = d;
+			F2x1 = b;
+		}
+		x2 = x1;
+		x1 = x;
+		return y;
+	}
+
+	// n samples in place
+	void process(float* v, int n) {
+		int k = 0;
+		if (order == 0) {
+#if defined(AD_SSE2)
+			__m128 one = _mm_set1_ps(1.0f), sign = _mm_set1_ps(-0.0f);
+			for (; k + 4 <= n; k += 4) {
+				__m128 x = _mm_loadu_ps(v + k);
+				x = (curve == kHardClip) ? _mm_min_ps(_mm_max_ps(x, _mm_sub_ps(sign, one)), one)
+					: _mm_div_ps(x, _mm_add_ps(one, _mm_andnot_ps(sign, x)));
+				_mm_storeu_ps(v + k, x);
+			}
+#elif defined(AD_NEON)
+			float32x4_t one = vdupq_n_f32(1.0f);
+			for (; k + 4 <= n; k += 4) {
+				float32x4_t x = vld1q_f32(v + k);
+				x = (curve == kHardClip) ? vminq_f32(vmaxq_f32(x, vnegq_f32(one)), one)
+					: vdivq_f32(x, vaddq_f32(one, vabsq_f32(x)));
+				vst1q_f32(v + k, x);
+			}
+#endif
+		}
+		for (; k < n; k++)
+			v[k] = (float) process(v[k]);
+	}
+
+	// the curve, and its first and second antiderivatives
+	double f(double x) const {
+		if (curve == kHardClip)
+			return (x < -1.0) ? -1.0 : (x > 1.0) ? 1.0 : x;
+		return x/(1.0 + fabs(x));
+	}
+
+	double F1(double x) const {
+		double a = fabs(x);
+		if (curve == kHardClip)
+			return (a <= 1.0) ? 0.5*x*x : a - 0.5;
+		return a - log1p(a);
+	}
+
+	double F2(double x) const {
+		double a = fabs(x), s = (x < 0.0) ? -1.0 : 1.0;
+		if (curve == kHardClip)
+			return (a <= 1.0) ? x*x*x/6.0 : s*(0.5*x*x + 1.0/6.0) - 0.5*x;
+		return s*(0.5*x*x + a - (1.0 + a)*log1p(a));
+	}
+};
+
+
+#endif	// __Antiderivative__
@@ -5,7 +5,7 @@
 // Created by   : Regina Collecchia + music424 staff
 // Company      : CCRMA - Stanford University
 // Description  : Applies upsampling -> anti-imaging -> distortion ->
-//                upsampling -> anti-aliasing
+//                upsampling -> anti-aliasing, to each channel
 // Date         : 5/4/14
 //------------------------------------------------------------------------------
 
@@ -14,6 +14,8 @@
 
 #include "public.sdk/source/vst2.x/audioeffectx.h"
 #include <math.h>
+#include "Oversampler.h"
+#include "Antiderivative.h"
 
 #ifndef dB
 // if below -100dB, set to -100dB to prevent taking log of zero
@@ -75,6 +77,8 @@ public:
 	// Processing
 	virtual void processReplacing (float** inputs, float** outputs, 
                                    VstInt32 sampleFrames);
+	virtual void setSampleRate (float sampleRate);
+	virtual void resume ();
     
 	// Program
 	virtual void setProgramName (char* name);
@@ -116,6 +120,9 @@ protected:
 		kParamGainOut,
 		kParamFcOut,
 		kParamQOut,
+		kParamOversample,
+		kParamPhase,
+		kParamAntialias,
 		kNumParams
 	};
     
@@ -130,6 +137,13 @@ protected:
 	float FcOutKnob, FcOutValue;	// output filter center frequency, Hz
 	float QOutKnob, QOutValue;	// output filter resonance, ratio
     
+	float OversampleKnob;	// oversampling factor, knob position
+	int OversampleValue;	// oversampling factor, 2 to 16
+	float PhaseKnob;	// oversampling filter phase, knob position
+	bool MinimumPhase;	// minimum rather than linear phase filters
+	float AntialiasKnob;	// antiderivative antialiasing, knob position
+	int AntialiasValue;	// antiderivative antialiasing order, 0 (off) to 2
+    
     
     // signal processing parameters and state
 	double fs;	// sampling rate, Hz
@@ -137,41 +151,22 @@ protected:
 	double drive, level;	// input, output gains, amplitude
     
 	double InCoefs[5];	// input filter coefficients
-	Biquad InFilter;	// input filter
+	Biquad InFilter[kNumInputs];	// input filter, per channel
     
 	double OutCoefs[5];	// input filter coefficients
-	Biquad OutFilter;	// output filter
+	Biquad OutFilter[kNumInputs];	// output filter, per channel
+    
+	// antiimaging/antialiasing filters, polyphase
+	PolyphaseOversampler Oversampler;
+	bool OversampleDirty;	// new factor, phase or order, taken at the next resume()
     
-	enum{kUSRatio = 8};	// upsampling factor, sampling rate ratio
-    // for a 12th order butterworth, there are 6 biquads
-	enum{kAAOrder = 6};	// antialiasing/antiimaging filter order, biquads
-	Biquad AIFilter[kAAOrder];	// antiimaging filter
-	Biquad AAFilter[kAAOrder];	// antialiasing filter
+	// waveshaper, with antiderivative antialiasing
+	AntiderivativeShaper Shaper[kNumInputs];
+	long latency();	// samples of delay the host should make up for
     
 };
 
 
-// antialiasing/antiimaging filter coefficients
-// Needs modification (cutoff freq, number of biquads)
-// If number of biquads changed, make sure to change kAAOrder above.
-
-
-// TODO: Design the Anti-alias/Anti-imaging filter in matlab and input here
-///////////////START//////////////////
-
-const static double AACoefs[6][5] = {
-//	{0.2929,    0.2929,         0,    -0.4142,         0,},
-    // b0, b1, b2, a1, a2
-    // coefficients from 12th order butterworth filter @ wc = 1/8*18000*2/fs
-    {1, 2.007432, 0.999811, -1.446267, 0.523905},
-    {1, 2.154725, 1.162919, -1.470134, 0.549047},
-    {1, 2.083154, 1.091078, -1.518503, 0.600013},
-    {1, 1.992643, 1.000233, -1.592605, 0.678095},
-    {1, 1.909414, 0.916698, -1.693855, 0.784779},
-    {1, 1.852631, 0.859706, -1.823127, 0.920990}
-};
-
-////////////////END/////////////////////
 
 
 
@@ -0,0 +1,183 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : EarlyReflections.h
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  : Sparse multi-tap early reflections. Both input channels are
+//              written into one circular buffer; each output channel has
+//              its own set of taps (times, gains, signs and which input they
+//              read), so the two sides come out decorrelated. Processing
+//              goes tap by tap over a whole block, so every tap is a
+//              contiguous scaled add.
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __EarlyReflections__
+#define __EarlyReflections__
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define ER_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ER_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define ER_NEON 1
+#endif
+
+#define kMaxERTaps		64			// per output channel
+#define kSpeedOfSound	343.0		// m/s
+
+
+//------------------------------------------------------------------------------
+//  Tap times, gains and source channels for a room about size metres across.
+//  Like an image-source model, the reflection count grows with the cube of
+//  time: tap k of n lands at the cube root of (k + jitter)/n of the way
+//  through the window, which runs from the first reflection to two
+//  crossings of the room. Gains fall off as 1/distance with random signs
+//  and are scaled to unit total energy. A quarter of the taps read the
+//  opposite input channel. Different seeds give decorrelated tap sets.
+inline void ERDesignTaps(long* delays, double* gains, int* sources, int n, int side,
+						 double size, double fs, unsigned long long seed)
+{
+	double last = 2.0*size/kSpeedOfSound;					// end of the early window, s
+	double first = 0.15*last;								// first reflection, s
+	double energy = 0.0;
+	int k;
+	for (k=0; k<n; k++) {
+		seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+		double u = (double)(seed >> 11)*(1.0/9007199254740992.0);		// [0,1)
+		seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+		double v = (double)(seed >> 11)*(1.0/9007199254740992.0);
+		seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+		double w = (double)(seed >> 11)*(1.0/9007199254740992.0);
+		double t = first + (last - first)*pow((k + u)/n, 1.0/3.0);
+		delays[k] = (long)(t*fs + 0.5);
+		gains[k] = (first/t)*((v < 0.5) ? -1.0 : 1.0);
+		sources[k] = (w < 0.25) ? 1-side : side;
+		energy += gains[k]*gains[k];
+	}
+	double norm = (energy > 0.0) ? 1.0/sqrt(energy) : 0.0;
+	for (k=0; k<n; k++)
+		gains[k] *= norm;
+}
+
+
+//------------------------------------------------------------------------------
+struct EarlyReflections {
+	double*	buf;					// [L | R], size samples each
+	long	capacity;				// samples per channel allocated
+	long	size, mask;
+	long	wp;						// write position, shared by both channels
+	int		numTaps;
+	long	delay[2][kMaxERTaps];	// [output channel][tap], samples
+	double	gain[2][kMaxERTaps];
+	int		source[2][kMaxERTaps];	// input channel each tap reads
+
+	EarlyReflections()	{	buf = 0; capacity = 0; size = 0; mask = 0; wp = 0; numTaps = 0;	}
+	~EarlyReflections()	{	delete[] buf;	}
+
+	// make room for delays up to longest samples with blocks of up to block
+	// frames; only ever grows, and clears the buffer if it does. Not
+	// real-time safe, call while suspended.
+	void Reserve(long longest, int block)
+	{
+		long s = 1;
+		while (s < longest + block)
+			s <<= 1;
+		if (s > capacity) {
+			delete[] buf;
+			buf = new double[2*s];
+			capacity = s;
+		}
+		size = s;
+		mask = s-1;
+		Reset();
+	}
+
+	// n taps per side, each at most the longest delay given to Reserve()
+	void SetTaps(const long* delaysL, const double* gainsL, const int* sourcesL,
+				 const long* delaysR, const double* gainsR, const int* sourcesR, int n)
+	{
+		numTaps = (n < kMaxERTaps) ? n : kMaxERTaps;
+		for (int k=0; k<numTaps; k++) {
+			delay[0][k] = delaysL[k]; gain[0][k] = gainsL[k]; source[0][k] = sourcesL[k];
+			delay[1][k] = delaysR[k]; gain[1][k] = gainsR[k]; source[1][k] = sourcesR[k];
+		}
+	}
+
+	void Reset()
+	{
+		if (buf)
+			memset(buf, 0, 2*size*sizeof(double));
+		wp = 0;
+	}
+
+	// n frames (at most the block size given to Reserve()); the input block
+	// goes in first, so taps may be shorter than the block, and x and y may
+	// be the same buffers
+	void Process(const double* xL, const double* xR, double* yL, double* yR, int n)
+	{
+		Write(buf, xL, n);
+		Write(buf + size, xR, n);
+		memset(yL, 0, n*sizeof(double));
+		memset(yR, 0, n*sizeof(double));
+		for (int c=0; c<2; c++) {
+			double* y = c ? yR : yL;
+			for (int k=0; k<numTaps; k++) {
+				const double* line = buf + source[c][k]*size;
+				long start = (wp - delay[c][k]) & mask;
+				long first = size - start;
+				if (first >= n) {
+					Accumulate(y, line + start, gain[c][k], n);
+				} else {
+					Accumulate(y, line + start, gain[c][k], (int)first);
+					Accumulate(y + first, line, gain[c][k], (int)(n - first));
+				}
+			}
+		}
+		wp = (wp + n) & mask;
+	}
+
+protected:
+	void Write(double* line, const double* x, int n)
+	{
+		long first = size - wp;
+		if (first >= n) {
+			memcpy(line + wp, x, n*sizeof(double));
+		} else {
+			memcpy(line + wp, x, first*sizeof(double));
+			memcpy(line, x + first, (n - first)*sizeof(double));
+		}
+	}
+
+	// y += g x
+	static void Accumulate(double* y, const double* x, double g, int n)
+	{
+		int i = 0;
+#if defined(ER_AVX)
+		__m256d vg = _mm256_set1_pd(g);
+		for (; i+4<=n; i+=4)
+			_mm256_storeu_pd(y+i, _mm256_add_pd(_mm256_loadu_pd(y+i), _mm256_mul_pd(vg, _mm256_loadu_pd(x+i))));
+#elif defined(ER_SSE2)
+		__m128d vg = _mm_set1_pd(g);
+		for (; i+2<=n; i+=2)
+			_mm_storeu_pd(y+i, _mm_add_pd(_mm_loadu_pd(y+i), _mm_mul_pd(vg, _mm_loadu_pd(x+i))));
+#elif defined(ER_NEON)
+		float64x2_t vg = vdupq_n_f64(g);
+		for (; i+2<=n; i+=2)
+			vst1q_f64(y+i, vaddq_f64(vld1q_f64(y+i), vmulq_f64(vg, vld1q_f64(x+i))));
+#endif
+		for (; i<n; i++)
+			y[i] += g*x[i];
+	}
+};
+
+
+#endif	// __EarlyReflections__
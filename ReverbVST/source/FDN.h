@@ -0,0 +1,605 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : FDN.h
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  : Block-processing feedback delay network. All delay lines
+//              live in one arena and share a single write position, so the
+//              pointers advance once per block; each block's reads are
+//              copied out into per-line scratch and go through the mixing
+//              matrix, output taps, inputs and shelf bank a stage at a time,
+//              each along the lines' rows of frames with the MixVec
+//              vectors, then are copied back. The matrix product is bound
+//              by its multiply-adds however the data is laid out, so this
+//              is only ~1.3-1.4x a frame-at-a-time loop in an SSE2 build,
+//              ~2x with AVX.
+//              The lines can be stored as double or float; the copies
+//              convert, so the feedback path is double either way.
+//              Optionally each line's length is swept slowly by an LFO
+//              bank and read with cubic Lagrange interpolation.
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __FDN__
+#define __FDN__
+
+#include "MixingMatrix.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI				3.14159265358979323846
+#endif
+
+#define kMaxFDNBlock	256			// frames per internal sub-block
+#define kMaxFDNOutputs	16			// output channels tapped off the lines
+#define kMaxFDNModDepth	128			// longest modulation sweep, samples
+#define kFDNModInterval	32			// LFOs are sampled on this grid of frames, linear in between
+#define kFDNModHeadroom	(kMaxFDNModDepth + 4)	// extra line length the sweep and interpolator need
+#define kLFOTableBits	10
+#define kLFOTableSize	(1 << kLFOTableBits)	// sine table points
+#define kLFORateSpread	0.2			// line rates spread over +-10% of the nominal rate
+
+// delay line storage; the feedback path always runs in double
+enum {
+    kFDNStoreDouble = 0,
+    kFDNStoreFloat						// half the memory traffic, ~-150 dB rounding per pass
+};
+
+
+//------------------------------------------------------------------------------
+//  one-pole, one-zero shelf filter per delay line, stored as arrays and run
+//  over a block of frames of all the lines at once. New coefficients can be
+//  ramped in linearly over a block; a straight line between two stable
+//  one-pole designs stays stable, so the ramp cannot blow up the loop.
+struct ShelfBank {
+    double	a1[kMaxMixOrder], b0[kMaxMixOrder], b1[kMaxMixOrder], z1[kMaxMixOrder];
+    double	ta1[kMaxMixOrder], tb0[kMaxMixOrder], tb1[kMaxMixOrder];	// ramp targets
+    double	da1[kMaxMixOrder], db0[kMaxMixOrder], db1[kMaxMixOrder];	// per-frame increments
+    int		rampLeft;								// frames until the targets are reached
+
+    ShelfBank()
+    {
+        for (int i=0; i<kMaxMixOrder; i++) {
+            a1[i]=ta1[i]=0.0; b0[i]=tb0[i]=1.0; b1[i]=tb1[i]=0.0;
+        }
+        rampLeft = 0;
+        Reset();
+    }
+    void	SetCoefs (int line, double* coefs)		//pointer to array: [b0 b1 a1], takes effect at once
+    {
+        a1[line]=ta1[line]=*(coefs+2); b0[line]=tb0[line]=*(coefs); b1[line]=tb1[line]=*(coefs+1);
+        rampLeft = 0;
+    }
+    void	SetTarget (int line, double* coefs)		// [b0 b1 a1], reached by StartRamp()
+    {	ta1[line]=*(coefs+2); tb0[line]=*(coefs); tb1[line]=*(coefs+1);}
+    void	StartRamp (int frames)						// glide every line to its target
+    {
+        if (frames < 1) frames = 1;
+        double r = 1.0/frames;
+        for (int i=0; i<kMaxMixOrder; i++) {
+            da1[i] = (ta1[i]-a1[i])*r; db0[i] = (tb0[i]-b0[i])*r; db1[i] = (tb1[i]-b1[i])*r;
+        }
+        rampLeft = frames;
+    }
+    void	Reset()	{	memset(z1, 0, sizeof(z1)); }
+    // filter frames frames of lines lines in place, a line per row (row l
+    // starts at x + l*stride), stepping the coefficients once a frame while
+    // a ramp runs. Each line's recursion is serial, so four lines run side
+    // by side to overlap their latencies.
+    void	ProcessBlock (double* x, int stride, int lines, int frames)
+    {
+        int i, l, k;
+        int ramp = (rampLeft < frames) ? rampLeft : frames;	// frames that still step the coefficients
+        for (l=0; l<lines; l++) {
+            double* xl = x + l*stride;
+            for (i=0; i<ramp; i++) {
+                if (rampLeft - i == 1) {
+                    a1[l] = ta1[l]; b0[l] = tb0[l]; b1[l] = tb1[l];
+                } else {
+                    a1[l] += da1[l]; b0[l] += db0[l]; b1[l] += db1[l];
+                }
+                double output = z1[l]+xl[i]*b0[l];
+                z1[l] = xl[i]*b1[l]-output*a1[l];
+                xl[i] = output;
+            }
+        }
+        rampLeft -= ramp;
+        //Transposed Direct II Form (PREFERRED)
+        for (l=0; l+4<=lines; l+=4) {
+            double *r[4], a[4], c0[4], c1[4], z[4];
+            for (k=0; k<4; k++) {
+                r[k] = x + (l+k)*stride; a[k] = a1[l+k]; c0[k] = b0[l+k]; c1[k] = b1[l+k]; z[k] = z1[l+k];
+            }
+            for (i=ramp; i<frames; i++)
+                for (k=0; k<4; k++) {
+                    double in = r[k][i], output = z[k]+in*c0[k];
+                    z[k] = in*c1[k]-output*a[k];
+                    r[k][i] = output;
+                }
+            for (k=0; k<4; k++)
+                z1[l+k] = z[k];
+        }
+        for (; l<lines; l++) {
+            double* xl = x + l*stride;
+            double z = z1[l];
+            for (i=ramp; i<frames; i++) {
+                double output = z+xl[i]*b0[l];
+                z = xl[i]*b1[l]-output*a1[l];
+                xl[i] = output;
+            }
+            z1[l] = z;
+        }
+    }
+};
+
+
+//------------------------------------------------------------------------------
+//  one slow sine per delay line, read from a shared table. Phases are 32-bit
+//  accumulators that wrap on their own; lines start spread around the cycle
+//  and run at slightly different rates so the sweeps never line up.
+struct LFOBank {
+    double			table[kLFOTableSize+1];			// one cycle plus a guard point
+    unsigned int	phase[kMaxMixOrder], inc[kMaxMixOrder];
+    int				count;
+
+    LFOBank()
+    {
+        for (int k=0; k<=kLFOTableSize; k++)
+            table[k] = sin(2*M_PI*k/kLFOTableSize);
+        count = 0;
+        memset(inc, 0, sizeof(inc));
+        Reset();
+    }
+    void	SetRate (int n, double rate, double fs)	// nominal rate in Hz for n lines
+    {
+        count = n;
+        for (int i=0; i<n; i++) {
+            double r = rate*(1.0 + kLFORateSpread*((n > 1) ? (double)i/(n-1) - 0.5 : 0.0));
+            inc[i] = (unsigned int)(r/fs*4294967296.0);
+        }
+        Reset();
+    }
+    void	Reset()
+    {
+        for (int i=0; i<kMaxMixOrder; i++)
+            phase[i] = (unsigned int)((double)i/(count > 0 ? count : 1)*4294967296.0);
+    }
+    double	Value (int line, int ahead) const				// line's LFO, ahead frames from now, in [-1,1]
+    {
+        unsigned int ph = phase[line] + inc[line]*(unsigned int)ahead;
+        unsigned int k = ph >> (32-kLFOTableBits);				// top bits index the table
+        double f = (ph & ((1u << (32-kLFOTableBits))-1))*(1.0/(1u << (32-kLFOTableBits)));
+        return table[k] + f*(table[k+1]-table[k]);
+    }
+    void	Advance (int frames)
+    {
+        for (int i=0; i<count; i++)
+            phase[i] += inc[i]*(unsigned int)frames;
+    }
+};
+
+
+//------------------------------------------------------------------------------
+//  feedback delay network
+class FDN {
+public:
+    FDN()
+    {
+        arena = 0; capacity = 0; storage = kFDNStoreDouble;
+        order = 0; lineSize = 0; mask = 0; wp = 0; minDelay = 1;
+        modDepth = modTarget = modSet = modStep = 0.0; modRampLeft = 0; gridPos = 0;
+        energy = energyCount = 0.0;
+        frozen = false; inGain = 1.0; inStep = 0.0; inRampLeft = 0;
+        memset(len, 0, sizeof(len));
+        memset(inL, 0, sizeof(inL)); memset(inR, 0, sizeof(inR));
+        memset(out, 0, sizeof(out)); numOutputs = 2;
+        memset(scratch, 0, sizeof(scratch)); memset(mixed, 0, sizeof(mixed));	// the padding past a block is read
+    }
+    ~FDN()	{	delete[] arena;	}
+
+    // set the order and delay lengths (samples). The arena only ever grows, so
+    // moving to a lower sample rate or order reuses the memory already held;
+    // call this while suspended, never from processReplacing.
+    void SetDelays(const long* lengths, int n)
+    {
+        long longest = 1;
+        order = n;
+        minDelay = lengths[0];
+        for (int i=0; i<n; i++) {
+            len[i] = lengths[i];
+            if (len[i] > longest) longest = len[i];
+            if (len[i] < minDelay) minDelay = len[i];
+        }
+        long size = 1;
+        while (size < longest + kMaxFDNBlock + kFDNModHeadroom)	// power of two, so wrapping is a mask
+            size <<= 1;
+        Reserve(size*n);
+        lineSize = size;
+        mask = size-1;
+        Reset();
+    }
+
+    // make sure the arena holds at least samples delay line samples in the
+    // current storage format, e.g. up front for the highest sample rate
+    // expected; if it has to grow, its contents are lost
+    void Reserve(long samples)
+    {
+        long bytes = samples*SampleSize();
+        if (bytes <= capacity)
+            return;
+        delete[] arena;
+        arena = new char[bytes];
+        capacity = bytes;
+        memset(arena, 0, capacity);
+    }
+
+    // kFDNStoreDouble or kFDNStoreFloat; clears the lines, call while suspended
+    void SetStorage(int format)
+    {
+        storage = format;
+        if (order > 0)
+            Reserve(lineSize*order);
+        Reset();
+    }
+    int GetStorage()	{	return storage;	}
+
+    // sweep each line's length between len and len+depth samples at around
+    // rate Hz (depth 0 turns it off, and the lines are read as plain
+    // integer delays again); call after SetDelays, while suspended
+    void SetModulation(double depth, double rate, double fs)
+    {
+        if (depth < 0.0) depth = 0.0;
+        if (depth > kMaxFDNModDepth) depth = kMaxFDNModDepth;
+        modSet = depth;
+        modDepth = modTarget = frozen ? 0.0 : depth;			// a frozen network stays unswept
+        modRampLeft = 0;
+        lfo.SetRate(order, rate, fs);
+    }
+    double GetModulation()	{	return modSet;	}
+
+    // Hold whatever is in the lines indefinitely. Over frames frames the
+    // shelves glide to unity, the inputs fade out and the delay sweep
+    // (whose interpolator is lossy) glides to zero; from then on every
+    // frame leaves the mixer with exactly the energy it was read with, so
+    // rounding can't make the loop grow or decay however long it runs.
+    // Unfreezing brings the inputs and the sweep back over frames frames;
+    // the caller glides the shelves back to its own design. Doesn't
+    // allocate, so it can be called between Process() calls.
+    void SetFreeze(bool on, int frames)
+    {
+        frozen = on;
+        if (on) {
+            double unity[3] = {1.0, 0.0, 0.0};
+            for (int i=0; i<order; i++)
+                fbfilt.SetTarget(i, unity);
+            fbfilt.StartRamp(frames);
+        }
+        double target = on ? 0.0 : 1.0;
+        if (frames > 1) {
+            inStep = (target - inGain)/frames;
+            inRampLeft = frames;
+        } else {
+            inGain = target;
+            inRampLeft = 0;
+        }
+        modTarget = on ? 0.0 : modSet;
+        int cells = frames/kFDNModInterval;
+        if (cells > 0 && modTarget != modDepth) {
+            modStep = (modTarget - modDepth)/cells;
+            modRampLeft = cells;
+        } else {
+            modDepth = modTarget;
+            modRampLeft = 0;
+        }
+    }
+    bool GetFreeze()	{	return frozen;	}
+    long SampleSize()	{	return (storage == kFDNStoreFloat) ? sizeof(float) : sizeof(double);	}
+
+    // per-line input (L,R) and output (L,R) gains
+    void SetTaps(const float* vinL, const float* vinR, const float* voutL, const float* voutR)
+    {
+        SetInputTaps(vinL, vinR);
+        numOutputs = 2;
+        for (int i=0; i<order; i++) {
+            out[0][i]=voutL[i]; out[1][i]=voutR[i];
+        }
+    }
+    void SetInputTaps(const float* vinL, const float* vinR)
+    {
+        for (int i=0; i<order; i++) {
+            inL[i]=vinL[i]; inR[i]=vinR[i];
+        }
+    }
+    // n output channels, taps row-major: taps[c*order + line]
+    void SetOutputTaps(const double* taps, int n)
+    {
+        numOutputs = (n < kMaxFDNOutputs) ? n : kMaxFDNOutputs;
+        for (int c=0; c<numOutputs; c++)
+            for (int i=0; i<order; i++)
+                out[c][i] = taps[c*order + i];
+    }
+    int GetNumOutputs()	{	return numOutputs;	}
+
+    void Reset()
+    {
+        if (arena)
+            memset(arena, 0, lineSize*order*SampleSize());
+        fbfilt.Reset();
+        lfo.Reset();
+        gridPos = 0;
+        wp = 0;
+    }
+
+    // run n frames; xL/xR feed the lines, y[0..outputs-1] receive the output taps
+    void Process(const double* xL, const double* xR, double* const* y, int n)
+    {
+        double* yb[kMaxFDNOutputs];
+        int c;
+        for (c=0; c<numOutputs; c++)
+            yb[c] = y[c];
+        energy = 0.0;
+        energyCount = n;
+        while (n > 0) {
+            int block = n;
+            if (block > kMaxFDNBlock) block = kMaxFDNBlock;
+            if (block > minDelay) block = (int)minDelay;	// reads must not overtake this block's writes
+            if (Swept() && block > minDelay-2)				// nor can the interpolator's newest tap
+                block = (int)minDelay-2;
+            ProcessBlock(xL, xR, yb, block);
+            xL += block; xR += block;
+            for (c=0; c<numOutputs; c++)
+                yb[c] += block;
+            n -= block;
+        }
+    }
+    // the same for the stereo taps
+    void Process(const double* xL, const double* xR, double* yL, double* yR, int n)
+    {
+        double* y[2] = {yL, yR};
+        Process(xL, xR, y, n);
+    }
+
+    // what the last Process() call wrote into the lines: sum of squares
+    // over the lines, mean over the frames
+    double Energy()	{	return (energyCount > 0.0) ? energy/energyCount : 0.0;	}
+
+    MixingMatrix mixer;							// feedback matrix
+    ShelfBank fbfilt;							// loss filters
+
+protected:
+    bool Swept()	{	return modDepth > 0.0 || modRampLeft > 0;	}
+
+    // sweep depth at the grid node j cells on from the current one
+    double DepthAhead(int j)	{	return (j < modRampLeft) ? modDepth + j*modStep : modTarget;	}
+
+    void ProcessBlock(const double* xL, const double* xR, double* const* y, int n)
+    {
+        double bus[kMaxFDNBlock];
+        int i, l, c;
+        // fully frozen: the loop is lossless, and only needs holding there
+        bool locked = frozen && fbfilt.rampLeft == 0 && inRampLeft == 0 && !Swept();
+
+        // gather this block's reads for every line
+        if (Swept()) {
+            // delays at the grid nodes this block touches, from the current
+            // cell's start on; the LFOs are only looked up here
+            double node[kMaxMixOrder][kMaxFDNBlock/kFDNModInterval + 2];
+            int nodes = (gridPos + n - 1)/kFDNModInterval + 2;
+            for (int j=0; j<nodes; j++)
+                for (l=0; l<order; l++)
+                    node[l][j] = len[l] + DepthAhead(j)*0.5*(1.0 + lfo.Value(l, j*kFDNModInterval));
+            if (storage == kFDNStoreFloat)
+                for (l=0; l<order; l++)
+                    ReadSwept((float*)arena + l*lineSize, node[l], scratch[l], n);
+            else
+                for (l=0; l<order; l++)
+                    ReadSwept((double*)arena + l*lineSize, node[l], scratch[l], n);
+            for (gridPos += n; gridPos >= kFDNModInterval; gridPos -= kFDNModInterval) {
+                lfo.Advance(kFDNModInterval);
+                if (modRampLeft > 0)
+                    modDepth = (--modRampLeft > 0) ? modDepth + modStep : modTarget;
+            }
+        } else if (storage == kFDNStoreFloat) {
+            for (l=0; l<order; l++)
+                CopyOut((float*)arena + l*lineSize, (wp - len[l]) & mask, scratch[l], n);
+        } else {
+            for (l=0; l<order; l++)
+                CopyOut((double*)arena + l*lineSize, (wp - len[l]) & mask, scratch[l], n);
+        }
+
+        // the rest runs a stage at a time over the whole block, along the
+        // lines' rows of frames, kMixWidth frames at a time; the rows are
+        // padded up to a multiple of that, and the padding is never used
+        int np = (n + kMixWidth-1) & ~(kMixWidth-1);
+        mixer.ProcessBlock(scratch[0], mixed[0], np, kMaxFDNBlock);	// add up contributions through the feedback matrix
+        if (locked)
+            Renormalize(np);
+
+        for (c=0; c<numOutputs; c++) {							// sum into the output busses
+            for (i=0; i<np; i++)
+                bus[i] = 0.0;
+            for (l=0; l<order; l++) {
+                const double* m = mixed[l];
+                MixVec g = MixSplat(out[c][l]);
+                for (i=0; i<np; i+=kMixWidth)
+                    MixStore(bus + i, MixAdd(MixLoad(bus + i), MixMul(g, MixLoad(m + i))));
+            }
+            memcpy(y[c], bus, n*sizeof(double));
+        }
+
+        if (!locked) {
+            double xl[kMaxFDNBlock], xr[kMaxFDNBlock];
+            for (i=0; i<n; i++) {
+                xl[i] = xL[i]*inGain; xr[i] = xR[i]*inGain;
+                if (inRampLeft > 0)
+                    inGain = (--inRampLeft > 0) ? inGain + inStep : (frozen ? 0.0 : 1.0);
+            }
+            for (; i<np; i++)
+                xl[i] = xr[i] = 0.0;
+            for (l=0; l<order; l++) {							// add in L,R contributions
+                double* m = mixed[l];
+                MixVec gl = MixSplat(inL[l]), gr = MixSplat(inR[l]);
+                for (i=0; i<np; i+=kMixWidth)
+                    MixStore(m + i, MixAdd(MixLoad(m + i), MixAdd(MixMul(gl, MixLoad(xl + i)), MixMul(gr, MixLoad(xr + i)))));
+            }
+            fbfilt.ProcessBlock(mixed[0], kMaxFDNBlock, order, n);	// filter data with shelves
+        }
+
+        for (i=0; i<np; i++)
+            bus[i] = 0.0;
+        for (l=0; l<order; l++) {
+            const double* m = mixed[l];
+            for (i=0; i<np; i+=kMixWidth) {
+                MixVec v = MixLoad(m + i);
+                MixStore(bus + i, MixAdd(MixLoad(bus + i), MixMul(v, v)));
+            }
+        }
+        for (i=0; i<n; i++)
+            energy += bus[i];
+
+        // write the block back and advance the shared write pointer once
+        if (storage == kFDNStoreFloat)
+            for (l=0; l<order; l++)
+                CopyIn((float*)arena + l*lineSize, wp & mask, mixed[l], n);
+        else
+            for (l=0; l<order; l++)
+                CopyIn((double*)arena + l*lineSize, wp & mask, mixed[l], n);
+        wp = (wp + n) & mask;
+    }
+
+    // scale each of the n frames (a multiple of kMixWidth) of mixed to the
+    // energy it had in scratch.
+    // An orthogonal mixer does this on its own up to rounding; doing it
+    // explicitly keeps the rounding from adding up to a drift over hours of
+    // freeze.
+    void Renormalize(int n)
+    {
+        double ex[kMaxFDNBlock], ey[kMaxFDNBlock];
+        int i, l;
+        for (i=0; i<n; i++)
+            ex[i] = ey[i] = 0.0;
+        for (l=0; l<order; l++) {
+            const double *x = scratch[l], *y = mixed[l];
+            for (i=0; i<n; i+=kMixWidth) {
+                MixVec u = MixLoad(x + i), v = MixLoad(y + i);
+                MixStore(ex + i, MixAdd(MixLoad(ex + i), MixMul(u, u)));
+                MixStore(ey + i, MixAdd(MixLoad(ey + i), MixMul(v, v)));
+            }
+        }
+        for (i=0; i<n; i++)
+            ex[i] = (ey[i] > 0.0) ? sqrt(ex[i]/ey[i]) : 1.0;	// the gain, from here on
+        for (l=0; l<order; l++) {
+            double* y = mixed[l];
+            for (i=0; i<n; i+=kMixWidth)
+                MixStore(y + i, MixMul(MixLoad(y + i), MixLoad(ex + i)));
+        }
+    }
+
+    // copy n samples starting at start out of a line (wrapping), converting to double
+    template <class T>
+    void CopyOut(const T* line, long start, double* dst, int n)
+    {
+        long first = lineSize - start;
+        if (first >= n) {
+            Convert(dst, line+start, n);
+        } else {
+            Convert(dst, line+start, (int)first);
+            Convert(dst+first, line, (int)(n-first));
+        }
+    }
+
+    // read n samples from a line whose delay is piecewise linear between the
+    // grid nodes in node[], with cubic Lagrange interpolation. Positions
+    // depend only on the absolute frame, so the output doesn't change with
+    // the host's block size. The weights only depend on the fractional
+    // positions; they are worked out for the whole block first, in loops
+    // with no memory access but their own, and the taps follow.
+    template <class T>
+    void ReadSwept(const T* line, const double* node, double* dst, int n)
+    {
+        double c0[kMaxFDNBlock], c1[kMaxFDNBlock], c2[kMaxFDNBlock], c3[kMaxFDNBlock];
+        int at[kMaxFDNBlock];
+        int i = 0, j = 0, u = gridPos, k;
+        while (i < n) {										// one grid cell at a time
+            int seg = n - i;
+            if (seg > kFDNModInterval - u) seg = kFDNModInterval - u;
+            double slope = (node[j+1] - node[j])*(1.0/kFDNModInterval);
+            for (k=0; k<seg; k++) {
+                // write position (kept in [lineSize, 2 lineSize) so the
+                // rounding is the same wherever the block starts) minus delay
+                double p = (double)(((wp + i + k) & mask) + lineSize) - (node[j] + slope*(u + k));
+                at[i+k] = (int)p;
+                c3[i+k] = p - at[i+k];						// fraction, until the weights overwrite it
+            }
+            i += seg; u = 0; j++;
+        }
+        for (i=0; i<n; i++) {
+            double f = c3[i];
+            double fm1 = f - 1.0, fm2 = f - 2.0, fp1 = f + 1.0;
+            c0[i] = -f*fm1*fm2*(1.0/6.0);
+            c1[i] = fp1*fm1*fm2*0.5;
+            c2[i] = -fp1*f*fm2*0.5;
+            c3[i] = fp1*f*fm1*(1.0/6.0);
+        }
+        long first = (at[0]-1) & mask;
+        if (at[n-1] >= at[0] && first + (at[n-1] - at[0]) + 4 <= lineSize) {
+            const T* base = line + first - (at[0]-1);		// no wrap inside the block: plain indexing
+            for (i=0; i<n; i++) {
+                const T* x = base + at[i];
+                dst[i] = c0[i]*x[-1] + c1[i]*x[0] + c2[i]*x[1] + c3[i]*x[2];
+            }
+        } else {
+            for (i=0; i<n; i++) {
+                int ip = at[i];
+                dst[i] = c0[i]*line[(ip-1) & mask] + c1[i]*line[ip & mask]
+                       + c2[i]*line[(ip+1) & mask] + c3[i]*line[(ip+2) & mask];
+            }
+        }
+    }
+
+    // copy n doubles into a line from start on (wrapping), converting to its format
+    template <class T>
+    void CopyIn(T* line, long start, const double* src, int n)
+    {
+        long first = lineSize - start;
+        if (first >= n) {
+            Convert(line+start, src, n);
+        } else {
+            Convert(line+start, src, (int)first);
+            Convert(line, src+first, (int)(n-first));
+        }
+    }
+
+    static void Convert(double* dst, const double* src, int n)	{	memcpy(dst, src, n*sizeof(double));	}
+    static void Convert(double* dst, const float* src, int n)	{	for (int i=0; i<n; i++) dst[i] = src[i];	}
+    static void Convert(float* dst, const double* src, int n)	{	for (int i=0; i<n; i++) dst[i] = (float)src[i];	}
+
+    char*	arena;								// order lines of lineSize samples each
+    long	capacity;							// allocated size of the arena, bytes
+    int		storage;							// kFDNStoreDouble or kFDNStoreFloat
+    int		order;
+    long	lineSize, mask;
+    long	wp;									// shared write position
+    long	len[kMaxMixOrder];					// delay lengths, samples
+    long	minDelay;
+    double	modDepth;							// sweep depth at the current grid node, samples; 0 for integer reads
+    double	modSet, modTarget, modStep;			// depth asked for, where the ramp is going, and its step per grid cell
+    int		modRampLeft;						// grid cells until modTarget is reached
+    bool	frozen;
+    double	inGain, inStep;						// input fade for freezing
+    int		inRampLeft;
+    LFOBank	lfo;
+    int		gridPos;							// frames into the current modulation grid cell
+    double	energy, energyCount;				// sum of squares written by the last Process(), and over how many frames
+    double	inL[kMaxMixOrder], inR[kMaxMixOrder];
+    double	out[kMaxFDNOutputs][kMaxMixOrder];	// output taps, [channel][line]
+    int		numOutputs;
+    double	scratch[kMaxMixOrder][kMaxFDNBlock];	// per-line block of reads
+    double	mixed[kMaxMixOrder][kMaxFDNBlock];	// the same through the matrix, then the block's writes
+};
+
+
+#endif	// __FDN__
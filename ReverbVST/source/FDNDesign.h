@@ -0,0 +1,217 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : FDNDesign.h
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  : Generators for the FDN tables that used to be typed in by
+//              hand: orthonormal feedback matrices (Hadamard, Householder,
+//              random as in orthonorm.m), mutually prime delay lengths and
+//              the alternating L/R input and output taps.
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __FDNDesign__
+#define __FDNDesign__
+
+#include "MixingMatrix.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI				3.14159265358979323846
+#endif
+
+// feedback matrix families
+enum {
+	kFDNHadamard = 0,		// Sylvester/Paley Hadamard, falls back to Householder
+	kFDNHouseholder,		// I - 2/N ones
+	kFDNRandom				// random orthonormal, see FDNRandomMatrix()
+};
+
+
+//------------------------------------------------------------------------------
+//  small helpers
+
+static inline bool FDNIsPrime(long x)
+{
+	if (x < 2) return false;
+	if (x % 2 == 0) return x == 2;
+	for (long d=3; d*d<=x; d+=2)
+		if (x % d == 0) return false;
+	return true;
+}
+
+// order of a Paley (type I) Hadamard core: q+1 with q prime, q = 3 mod 4
+static inline bool FDNIsPaleyOrder(int n)
+{
+	return n == 1 || (n % 4 == 0 && FDNIsPrime(n-1));
+}
+
+// true if FDNHadamardMatrix() can build an order n matrix, i.e. n = 2^k * m
+// with m a Paley order
+static inline bool FDNHasHadamard(int n)
+{
+	if (n < 1 || n > kMaxMixOrder) return false;
+	while (n % 2 == 0 && !FDNIsPaleyOrder(n))
+		n /= 2;
+	return FDNIsPaleyOrder(n);
+}
+
+
+//------------------------------------------------------------------------------
+//  Householder reflection I - 2/N ones, row-major into m[n*n]
+static inline void FDNHouseholderMatrix(double* m, int n)
+{
+	for (int i=0; i<n; i++)
+		for (int j=0; j<n; j++)
+			m[i*n+j] = ((i == j) ? 1.0 : 0.0) - 2.0/n;
+}
+
+
+//------------------------------------------------------------------------------
+//  Hadamard matrix scaled by 1/sqrt(N), row-major into m[n*n]. The Paley core
+//  is built first and doubled up Sylvester style; a pure power of two comes
+//  out in natural order, which MixingMatrix runs on its butterfly kernel.
+//  Orders without a construction here get the Householder matrix instead.
+static inline void FDNHadamardMatrix(double* m, int n)
+{
+	if (!FDNHasHadamard(n)) {
+		FDNHouseholderMatrix(m, n);
+		return;
+	}
+
+	int core = n, i, j;
+	if ((n & (n-1)) == 0)
+		core = 1;								// powers of two: pure Sylvester
+	else
+		while (core % 2 == 0 && !FDNIsPaleyOrder(core))
+			core /= 2;
+
+	// Paley I: H = I + S, S the skew conference matrix bordered by ones
+	double h[kMaxMixOrder*kMaxMixOrder];
+	if (core == 1) {
+		h[0] = 1.0;
+	} else {
+		int q = core-1;
+		for (i=0; i<core; i++)
+			for (j=0; j<core; j++) {
+				double s;
+				if (i == j)			s = 0.0;
+				else if (i == 0)	s = 1.0;
+				else if (j == 0)	s = -1.0;
+				else {				// Legendre symbol of (j-i) mod q
+					int d = ((j-i) % q + q) % q, k;
+					s = -1.0;
+					for (k=1; k<q; k++)
+						if ((k*k) % q == d) { s = 1.0; break; }
+				}
+				h[i*core+j] = s + ((i == j) ? 1.0 : 0.0);
+			}
+	}
+
+	// Sylvester doubling: [H H; H -H]
+	int size = core;
+	while (size < n) {
+		for (i=size-1; i>=0; i--)
+			for (j=size-1; j>=0; j--) {
+				double v = h[i*size+j];
+				h[i*2*size+j] = v;
+				h[i*2*size+j+size] = v;
+				h[(i+size)*2*size+j] = v;
+				h[(i+size)*2*size+j+size] = -v;
+			}
+		size *= 2;
+	}
+
+	double c = 1.0/sqrt((double)n);
+	for (i=0; i<n*n; i++)
+		m[i] = c*h[i];
+}
+
+
+//------------------------------------------------------------------------------
+//  random orthonormal matrix, the in-code version of orthonorm.m: gaussian
+//  entries weighted by exp(-dcy*|i-j|), then Gram-Schmidt on the rows. dcy = 0
+//  gives a uniformly dense matrix, larger dcy keeps more energy on the
+//  diagonal (less mixing per pass). The seed makes presets reproducible.
+static inline void FDNRandomMatrix(double* m, int n, double dcy, unsigned long long seed)
+{
+	unsigned long long state = seed ? seed : 1;
+	int i, j, k, pass;
+	for (i=0; i<n; i++)
+		for (j=0; j<n; j++) {
+			double u1, u2;
+			state = state*6364136223846793005ULL + 1442695040888963407ULL;	// 64-bit LCG
+			u1 = ((state >> 11) + 1.0) / 9007199254740993.0;
+			state = state*6364136223846793005ULL + 1442695040888963407ULL;
+			u2 = (state >> 11) / 9007199254740992.0;
+			double g = sqrt(-2.0*log(u1))*cos(2.0*M_PI*u2);			// Box-Muller
+			m[i*n+j] = g*exp(-dcy*fabs((double)(i-j)));
+		}
+
+	for (i=0; i<n; i++) {
+		for (pass=0; pass<2; pass++)			// twice, to keep it orthogonal to double precision
+			for (k=0; k<i; k++) {
+				double dot = 0.0;
+				for (j=0; j<n; j++)
+					dot += m[i*n+j]*m[k*n+j];
+				for (j=0; j<n; j++)
+					m[i*n+j] -= dot*m[k*n+j];
+			}
+		double norm = 0.0;
+		for (j=0; j<n; j++)
+			norm += m[i*n+j]*m[i*n+j];
+		norm = 1.0/sqrt(norm);
+		for (j=0; j<n; j++)
+			m[i*n+j] *= norm;
+	}
+}
+
+
+//------------------------------------------------------------------------------
+//  n mutually prime delay lengths spread geometrically over [shortest,
+//  longest] samples; each length is the next unused prime at or above its
+//  spot, so no two lines share a common factor
+static inline void FDNPrimeDelays(long* lens, int n, double shortest, double longest)
+{
+	long last = 1;
+	for (int i=0; i<n; i++) {
+		double spot = (n > 1) ? shortest*pow(longest/shortest, (double)i/(n-1)) : shortest;
+		long len = (long)floor(spot + 0.5);
+		if (len <= last) len = last+1;
+		while (!FDNIsPrime(len))
+			len++;
+		lens[i] = len;
+		last = len;
+	}
+}
+
+
+//------------------------------------------------------------------------------
+//  output taps for outputs channels (at most n) off n lines: rows of a random
+//  orthonormal matrix, so every pair of channels is uncorrelated for a
+//  diffuse tail. Scaled by sqrt(n/2) so each channel carries as much of the
+//  tail as one side of the alternating stereo taps.
+static inline void FDNOutputTaps(double* taps, int outputs, int n, unsigned long long seed)
+{
+	double m[kMaxMixOrder*kMaxMixOrder];
+	FDNRandomMatrix(m, n, 0.0, seed);
+	double g = sqrt(n/2.0);
+	for (int i=0; i<outputs*n; i++)
+		taps[i] = g*m[i];
+}
+
+
+//------------------------------------------------------------------------------
+//  even lines are fed from and summed into the left channel, odd lines the right
+static inline void FDNAlternatingTaps(float* inL, float* inR, float* outL, float* outR, int n)
+{
+	for (int i=0; i<n; i++) {
+		inL[i] = outL[i] = (i % 2 == 0) ? 1.0f : 0.0f;
+		inR[i] = outR[i] = (i % 2 == 1) ? 1.0f : 0.0f;
+	}
+}
+
+
+#endif	// __FDNDesign__
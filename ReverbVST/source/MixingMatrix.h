@@ -0,0 +1,351 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : MixingMatrix.h
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  : FDN feedback matrix with structured fast paths. The matrix
+//              is inspected once when it is set; identity, Householder-like
+//              (diagonal + constant) and Sylvester-Hadamard matrices run on
+//              dedicated kernels, anything else runs on a vectorised dense
+//              matrix-vector product.
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __MixingMatrix__
+#define __MixingMatrix__
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MIX_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIX_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MIX_NEON 1
+#endif
+
+#define kMaxMixOrder	64
+#define kMaxBlockFrames	256			// longest block ProcessBlock() takes
+
+
+//------------------------------------------------------------------------------
+//  kMixWidth doubles side by side, for the loops that run along a block of
+//  frames (a line per row) instead of across the lines
+#if defined(MIX_AVX)
+#define kMixWidth	4
+typedef __m256d MixVec;
+static inline MixVec MixLoad(const double* p)		{	return _mm256_loadu_pd(p);	}
+static inline void MixStore(double* p, MixVec a)	{	_mm256_storeu_pd(p, a);	}
+static inline MixVec MixSplat(double a)			{	return _mm256_set1_pd(a);	}
+static inline MixVec MixAdd(MixVec a, MixVec b)	{	return _mm256_add_pd(a, b);	}
+static inline MixVec MixSub(MixVec a, MixVec b)	{	return _mm256_sub_pd(a, b);	}
+static inline MixVec MixMul(MixVec a, MixVec b)	{	return _mm256_mul_pd(a, b);	}
+#elif defined(MIX_SSE2)
+#define kMixWidth	2
+typedef __m128d MixVec;
+static inline MixVec MixLoad(const double* p)		{	return _mm_loadu_pd(p);	}
+static inline void MixStore(double* p, MixVec a)	{	_mm_storeu_pd(p, a);	}
+static inline MixVec MixSplat(double a)			{	return _mm_set1_pd(a);	}
+static inline MixVec MixAdd(MixVec a, MixVec b)	{	return _mm_add_pd(a, b);	}
+static inline MixVec MixSub(MixVec a, MixVec b)	{	return _mm_sub_pd(a, b);	}
+static inline MixVec MixMul(MixVec a, MixVec b)	{	return _mm_mul_pd(a, b);	}
+#elif defined(MIX_NEON)
+#define kMixWidth	2
+typedef float64x2_t MixVec;
+static inline MixVec MixLoad(const double* p)		{	return vld1q_f64(p);	}
+static inline void MixStore(double* p, MixVec a)	{	vst1q_f64(p, a);	}
+static inline MixVec MixSplat(double a)			{	return vdupq_n_f64(a);	}
+static inline MixVec MixAdd(MixVec a, MixVec b)	{	return vaddq_f64(a, b);	}
+static inline MixVec MixSub(MixVec a, MixVec b)	{	return vsubq_f64(a, b);	}
+static inline MixVec MixMul(MixVec a, MixVec b)	{	return vmulq_f64(a, b);	}
+#else
+#define kMixWidth	1
+typedef double MixVec;
+static inline MixVec MixLoad(const double* p)		{	return *p;	}
+static inline void MixStore(double* p, MixVec a)	{	*p = a;	}
+static inline MixVec MixSplat(double a)			{	return a;	}
+static inline MixVec MixAdd(MixVec a, MixVec b)	{	return a + b;	}
+static inline MixVec MixSub(MixVec a, MixVec b)	{	return a - b;	}
+static inline MixVec MixMul(MixVec a, MixVec b)	{	return a * b;	}
+#endif
+
+
+//------------------------------------------------------------------------------
+//  N x N feedback matrix, y = M x
+//
+//  The dense kernel keeps the plain row loop's summation order for every
+//  output, so it is bit-identical to it (as long as the compiler does not fuse
+//  the multiply-adds). The Hadamard and Householder kernels reorder the sums
+//  and agree with the dense product to within a few ulps.
+struct MixingMatrix {
+	enum {
+		kMixDense = 0,		// plain O(N^2) product
+		kMixIdentity,		// no mixing at all
+		kMixHouseholder,	// d*I + o*ones, O(N)
+		kMixHadamard		// c * Sylvester Hadamard, O(N log N) butterflies
+	};
+
+	int		order;									// number of delay lines
+	int		kind;									// one of the kernels above
+	double	m[kMaxMixOrder][kMaxMixOrder];			// dense copy, row = output
+	double	mt[kMaxMixOrder][kMaxMixOrder];			// transposed, [input][output] (0 on padding)
+	double	scale;									// c for the Hadamard kernel
+	double	diag, offdiag;							// Householder-like kernel
+
+	MixingMatrix()	{	order = 0; kind = kMixIdentity; scale = 1.0; diag = 1.0; offdiag = 0.0;	}
+
+	// copy a row-major N x N matrix and pick the cheapest exact kernel for it;
+	// pass structured = false to force the dense product (for A/B listening)
+	void SetMatrix(const double* coefs, int n, bool structured = true)
+	{
+		int i, j;
+		order = n;
+		memset(m, 0, sizeof(m));
+		memset(mt, 0, sizeof(mt));
+		for (i=0; i<n; i++)
+			for (j=0; j<n; j++) {
+				m[i][j] = coefs[i*n+j];
+				mt[j][i] = m[i][j];
+			}
+
+		kind = kMixDense;
+		if (!structured)
+			return;
+
+		// diagonal + constant (covers the identity and every Householder reflection)
+		bool house = true;
+		diag = m[0][0];
+		offdiag = (n > 1) ? m[0][1] : 0.0;
+		for (i=0; i<n && house; i++)
+			for (j=0; j<n; j++)
+				if (m[i][j] != ((i == j) ? diag : offdiag)) { house = false; break; }
+		if (house) {
+			kind = (diag == 1.0 && offdiag == 0.0) ? kMixIdentity : kMixHouseholder;
+			return;
+		}
+
+		// c * natural-order Sylvester Hadamard: m = c*(-1)^popcount(i & j)
+		scale = m[0][0];
+		if ((n & (n-1)) != 0 || scale <= 0.0)
+			return;
+		for (i=0; i<n; i++)
+			for (j=0; j<n; j++) {
+				int bits = i & j, parity = 0;
+				while (bits) { parity ^= 1; bits &= bits-1; }
+				if (m[i][j] != (parity ? -scale : scale))
+					return;
+			}
+		kind = kMixHadamard;
+	}
+
+	// y = M x; x and y must not alias and must hold kMaxMixOrder entries
+	void Process(const double* x, double* y)
+	{
+		switch (kind) {
+			case kMixIdentity:		memcpy(y, x, order*sizeof(double));	break;
+			case kMixHouseholder:	ProcessHouseholder(x, y);				break;
+			case kMixHadamard:		ProcessHadamard(x, y);					break;
+			default:				ProcessDense(x, y);						break;
+		}
+	}
+
+	// the same for n frames at once, stored a line per row: row j of x (and
+	// of y) starts at x + j*stride. n must be a multiple of kMixWidth. Every
+	// step works on whole rows, kMixWidth frames at a time, and each output
+	// is summed in the same order as by Process(). x and y must not overlap.
+	void ProcessBlock(const double* x, double* y, int n, int stride)
+	{
+		int i, j, k, h;
+		switch (kind) {
+			case kMixIdentity:
+				for (j=0; j<order; j++)
+					memcpy(y + j*stride, x + j*stride, n*sizeof(double));
+				break;
+			case kMixHouseholder: {
+				double sum[kMaxBlockFrames];
+				MixVec o = MixSplat(offdiag), d = MixSplat(diag - offdiag);
+				for (i=0; i<n; i+=kMixWidth) {
+					MixVec a = MixLoad(x + i);
+					for (j=1; j<order; j++)
+						a = MixAdd(a, MixLoad(x + j*stride + i));
+					MixStore(sum + i, MixMul(a, o));
+				}
+				for (j=0; j<order; j++) {
+					const double* xj = x + j*stride;
+					double* yj = y + j*stride;
+					for (i=0; i<n; i+=kMixWidth)
+						MixStore(yj + i, MixAdd(MixMul(d, MixLoad(xj + i)), MixLoad(sum + i)));
+				}
+				break;
+			}
+			case kMixHadamard: {
+				MixVec c = MixSplat(scale);
+				for (j=0; j<order; j++) {
+					const double* xj = x + j*stride;
+					double* yj = y + j*stride;
+					for (i=0; i<n; i+=kMixWidth)
+						MixStore(yj + i, MixMul(c, MixLoad(xj + i)));
+				}
+				for (h=1; h<order; h<<=1)
+					for (k=0; k<order; k+=2*h)
+						for (j=k; j<k+h; j++) {
+							double* a = y + j*stride;
+							double* b = y + (j+h)*stride;
+							for (i=0; i<n; i+=kMixWidth) {
+								MixVec u = MixLoad(a + i), v = MixLoad(b + i);
+								MixStore(a + i, MixAdd(u, v));
+								MixStore(b + i, MixSub(u, v));
+							}
+						}
+				break;
+			}
+			default:
+				// four outputs at a time, each summed in a register; m is
+				// padded with zero rows, so the last group can run past order
+				for (k=0; k<order; k+=4) {
+					for (i=0; i<n; i+=kMixWidth) {
+						MixVec a0 = MixSplat(0.0), a1 = a0, a2 = a0, a3 = a0;
+						for (j=0; j<order; j++) {
+							MixVec xj = MixLoad(x + j*stride + i);
+							a0 = MixAdd(a0, MixMul(MixSplat(m[k][j]), xj));
+							a1 = MixAdd(a1, MixMul(MixSplat(m[k+1][j]), xj));
+							a2 = MixAdd(a2, MixMul(MixSplat(m[k+2][j]), xj));
+							a3 = MixAdd(a3, MixMul(MixSplat(m[k+3][j]), xj));
+						}
+						MixStore(y + k*stride + i, a0);
+						if (k+1 < order) MixStore(y + (k+1)*stride + i, a1);
+						if (k+2 < order) MixStore(y + (k+2)*stride + i, a2);
+						if (k+3 < order) MixStore(y + (k+3)*stride + i, a3);
+					}
+				}
+				break;
+		}
+	}
+
+	void ProcessHouseholder(const double* x, double* y)
+	{
+		double sum = 0.0;
+		int i;
+		for (i=0; i<order; i++)
+			sum += x[i];
+		sum *= offdiag;
+		double d = diag - offdiag;
+		for (i=0; i<order; i++)
+			y[i] = d*x[i] + sum;
+	}
+
+	void ProcessHadamard(const double* x, double* y)
+	{
+		int i, j, h, n = order;
+		for (i=0; i<n; i++)
+			y[i] = scale*x[i];
+		for (h=1; h<n; h<<=1) {
+#if defined(MIX_AVX)
+			if (h >= 4) {
+				for (i=0; i<n; i+=2*h)
+					for (j=i; j<i+h; j+=4) {
+						__m256d a = _mm256_loadu_pd(y+j), b = _mm256_loadu_pd(y+j+h);
+						_mm256_storeu_pd(y+j, _mm256_add_pd(a, b));
+						_mm256_storeu_pd(y+j+h, _mm256_sub_pd(a, b));
+					}
+				continue;
+			}
+#elif defined(MIX_SSE2)
+			if (h >= 2) {
+				for (i=0; i<n; i+=2*h)
+					for (j=i; j<i+h; j+=2) {
+						__m128d a = _mm_loadu_pd(y+j), b = _mm_loadu_pd(y+j+h);
+						_mm_storeu_pd(y+j, _mm_add_pd(a, b));
+						_mm_storeu_pd(y+j+h, _mm_sub_pd(a, b));
+					}
+				continue;
+			}
+#elif defined(MIX_NEON)
+			if (h >= 2) {
+				for (i=0; i<n; i+=2*h)
+					for (j=i; j<i+h; j+=2) {
+						float64x2_t a = vld1q_f64(y+j), b = vld1q_f64(y+j+h);
+						vst1q_f64(y+j, vaddq_f64(a, b));
+						vst1q_f64(y+j+h, vsubq_f64(a, b));
+					}
+				continue;
+			}
+#endif
+			for (i=0; i<n; i+=2*h)
+				for (j=i; j<i+h; j++) {
+					double a = y[j], b = y[j+h];
+					y[j] = a + b;
+					y[j+h] = a - b;
+				}
+		}
+	}
+
+	// each output is summed in order of j, like the plain row loop, but the
+	// loop runs down the columns so it vectorises across outputs with four
+	// independent accumulators per pass
+	void ProcessDense(const double* x, double* y)
+	{
+		int i, j, n = order;
+		double acc[kMaxMixOrder];
+#if defined(MIX_AVX)
+		for (i=0; i<n; i+=16) {
+			__m256d a0 = _mm256_setzero_pd(), a1 = a0, a2 = a0, a3 = a0;
+			for (j=0; j<n; j++) {
+				__m256d xj = _mm256_set1_pd(x[j]);
+				const double* cj = mt[j]+i;
+				a0 = _mm256_add_pd(a0, _mm256_mul_pd(xj, _mm256_loadu_pd(cj)));
+				a1 = _mm256_add_pd(a1, _mm256_mul_pd(xj, _mm256_loadu_pd(cj+4)));
+				a2 = _mm256_add_pd(a2, _mm256_mul_pd(xj, _mm256_loadu_pd(cj+8)));
+				a3 = _mm256_add_pd(a3, _mm256_mul_pd(xj, _mm256_loadu_pd(cj+12)));
+			}
+			_mm256_storeu_pd(acc+i, a0); _mm256_storeu_pd(acc+i+4, a1);
+			_mm256_storeu_pd(acc+i+8, a2); _mm256_storeu_pd(acc+i+12, a3);
+		}
+#elif defined(MIX_SSE2)
+		for (i=0; i<n; i+=8) {
+			__m128d a0 = _mm_setzero_pd(), a1 = a0, a2 = a0, a3 = a0;
+			for (j=0; j<n; j++) {
+				__m128d xj = _mm_set1_pd(x[j]);
+				const double* cj = mt[j]+i;
+				a0 = _mm_add_pd(a0, _mm_mul_pd(xj, _mm_loadu_pd(cj)));
+				a1 = _mm_add_pd(a1, _mm_mul_pd(xj, _mm_loadu_pd(cj+2)));
+				a2 = _mm_add_pd(a2, _mm_mul_pd(xj, _mm_loadu_pd(cj+4)));
+				a3 = _mm_add_pd(a3, _mm_mul_pd(xj, _mm_loadu_pd(cj+6)));
+			}
+			_mm_storeu_pd(acc+i, a0); _mm_storeu_pd(acc+i+2, a1);
+			_mm_storeu_pd(acc+i+4, a2); _mm_storeu_pd(acc+i+6, a3);
+		}
+#elif defined(MIX_NEON)
+		for (i=0; i<n; i+=8) {
+			float64x2_t a0 = vdupq_n_f64(0.0), a1 = a0, a2 = a0, a3 = a0;
+			for (j=0; j<n; j++) {
+				float64x2_t xj = vdupq_n_f64(x[j]);
+				const double* cj = mt[j]+i;
+				a0 = vaddq_f64(a0, vmulq_f64(xj, vld1q_f64(cj)));
+				a1 = vaddq_f64(a1, vmulq_f64(xj, vld1q_f64(cj+2)));
+				a2 = vaddq_f64(a2, vmulq_f64(xj, vld1q_f64(cj+4)));
+				a3 = vaddq_f64(a3, vmulq_f64(xj, vld1q_f64(cj+6)));
+			}
+			vst1q_f64(acc+i, a0); vst1q_f64(acc+i+2, a1);
+			vst1q_f64(acc+i+4, a2); vst1q_f64(acc+i+6, a3);
+		}
+#else
+		for (i=0; i<n; i++) {
+			double a = 0.0;
+			for (j=0; j<n; j++)
+				a += mt[j][i]*x[j];
+			acc[i] = a;
+		}
+#endif
+		memcpy(y, acc, n*sizeof(double));
+	}
+};
+
+
+#endif	// __MixingMatrix__
@@ -0,0 +1,61 @@
+//------------------------------------------------------------------------------
+// VST Effect Plug-in
+//
+// Filename     : NoDenormals.h
+// Created by   : music424 staff
+// Company      : Stanford
+// Description  : Scoped flush-to-zero / denormals-are-zero. Put one at the
+//              top of processReplacing: decaying recursive filters and
+//              feedback loops stop paying for denormal arithmetic, and the
+//              host's FPU state is restored on the way out.
+//
+// Date         : 10/17/26
+//------------------------------------------------------------------------------
+
+#ifndef __NoDenormals__
+#define __NoDenormals__
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define NODENORM_SSE 1
+#elif defined(__aarch64__)
+#define NODENORM_ARM64 1
+#endif
+
+
+//------------------------------------------------------------------------------
+//  sets FTZ and DAZ (SSE MXCSR) or FZ (AArch64 FPCR) for its lifetime;
+//  on = false leaves the FPU alone, to measure what flushing saves
+class ScopedNoDenormals {
+public:
+#if defined(NODENORM_SSE)
+	ScopedNoDenormals(bool on = true)
+	{
+		saved = _mm_getcsr();
+		if (on)
+			_mm_setcsr(saved | 0x8040);				// FTZ (bit 15) | DAZ (bit 6)
+	}
+	~ScopedNoDenormals()	{	_mm_setcsr(saved);	}
+private:
+	unsigned int saved;
+#elif defined(NODENORM_ARM64)
+	ScopedNoDenormals(bool on = true)
+	{
+		__asm__ __volatile__("mrs %0, fpcr" : "=r"(saved));
+		unsigned long long fz = on ? saved | (1ULL << 24) : saved;	// FZ
+		__asm__ __volatile__("msr fpcr, %0" : : "r"(fz));
+	}
+	~ScopedNoDenormals()	{	__asm__ __volatile__("msr fpcr, %0" : : "r"(saved));	}
+private:
+	unsigned long long saved;
+#else
+	ScopedNoDenormals(bool = true)	{}				// no control over the FPU here
+#endif
+
+private:
+	ScopedNoDenormals(const ScopedNoDenormals&);
+	ScopedNoDenormals& operator=(const ScopedNoDenormals&);
+};
+
+
+#endif	// __NoDenormals__